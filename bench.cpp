@@ -0,0 +1,90 @@
+// Benchmark suite for the replacement engines.
+//
+// Build: g++ -std=c++17 -O2 -pthread bench.cpp -o bench
+// Usage: bench [--quick] [--reps N] [--out results.csv]
+//
+// Runs every policy from "Run All" over a fixed matrix of synthetic
+// workloads (see WorkloadGenerator), trace sizes and frame counts. Each cell
+// gets one warmup run and N timed repetitions. One CSV row per cell is
+// written with the median and fastest time per reference. Traces come from
+// fixed seeds, so runs on different builds can be compared directly.
+#define OS_PROJECT_NO_MAIN
+#include "os_project.cpp"
+
+struct Workload {
+    string name;
+    WorkloadSpec spec;
+};
+
+WorkloadSpec spec(const string& kind, uint32_t pageSpace) {
+    WorkloadSpec w;
+    w.kind = kind;
+    w.pageSpace = pageSpace;
+    w.seed = 12345;
+    return w;
+}
+
+vector<Workload> workloads() {
+    vector<Workload> list = {
+        {"uniform-64k", spec("uniform", 65536)},
+        {"zipf-1m", spec("zipf", 1000000)},
+        {"loop-8k", spec("loop", 8192)},
+        {"phased-1m", spec("phased", 1000000)},
+        {"scan+hot-1m", spec("scan+hot", 1000000)},
+    };
+    list[2].spec.loopLength = 8192;
+    list[3].spec.workingSet = 4096;
+    list[4].spec.hotPages = 2048;
+    return list;
+}
+
+int main(int argc, char** argv) {
+    bool quick = false;
+    int reps = 5;
+    string outPath;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--quick") quick = true;
+        else if (arg == "--reps" && i + 1 < argc) reps = max(1, atoi(argv[++i]));
+        else if (arg == "--out" && i + 1 < argc) outPath = argv[++i];
+        else {
+            cerr << "Usage: bench [--quick] [--reps N] [--out results.csv]\n";
+            return 1;
+        }
+    }
+
+    vector<size_t> sizes = quick ? vector<size_t>{100000} : vector<size_t>{100000, 1000000, 10000000};
+    vector<int> frameCounts = quick ? vector<int>{64, 1024} : vector<int>{16, 256, 4096, 65536};
+
+    ofstream file;
+    if (!outPath.empty()) file.open(outPath);
+    ostream& results = outPath.empty() ? cout : file;
+    results << "Workload,References,Frames,Algorithm,Hits,Faults,MedianNsPerRef,MinNsPerRef\n";
+
+    vector<PolicyRun> policies = allPolicies(SimSettings());
+    for (const Workload& w : workloads()) {
+        for (size_t n : sizes) {
+            vector<int> pages = generateWorkload(w.spec, n);
+            for (int frames : frameCounts) {
+                for (const PolicyRun& policy : policies) {
+                    ostringstream sink;
+                    pair<long long, long long> counts = policy.run(pages, frames, sink, sink); // warmup
+                    vector<double> ns;
+                    for (int r = 0; r < reps; ++r) {
+                        sink.str("");
+                        auto start = steady_clock::now();
+                        policy.run(pages, frames, sink, sink);
+                        ns.push_back(duration<double, nano>(steady_clock::now() - start).count() / n);
+                    }
+                    sort(ns.begin(), ns.end());
+                    results << w.name << "," << n << "," << frames << "," << policy.name << ","
+                            << counts.first << "," << counts.second << "," << fixed << setprecision(2)
+                            << ns[ns.size() / 2] << "," << ns[0] << "\n";
+                    results.flush();
+                    cerr << w.name << " n=" << n << " frames=" << frames << " " << policy.name << "\n";
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -1,588 +1,5705 @@
-#include <iostream>
-#include <vector>
-#include <unordered_set>
-#include <unordered_map>
-#include <queue>
-#include <list>
-#include <algorithm>
-#include <iomanip>
-#include <chrono>
-#include <fstream>
-#include <cstdlib>
-#include <ctime>
-#include <climits>
-#include <map>
-#include <cmath>
-#include <string>
-
-#ifdef _WIN32
-#include <windows.h>
-#else
-#include <unistd.h>
-#endif
-
-using namespace std;
-using namespace chrono;
-
-void clearConsole() {
-#ifdef _WIN32
-    system("cls");
-#else
-    system("clear");
-#endif
-}
-
-void printFrames(const string& algo, int page, const vector<int>& frames, bool hit) {
-    cout << "\n[" << algo << "] Page Reference: " << page << "\n";
-    cout << (hit ? "  Page HIT " : "  Page FAULT ") << "\n";
-    cout << "Current Frames: ";
-    for (int f : frames) cout << (f == -1 ? '-' : f) << " ";
-    cout << "\n" << string(40, '-') << "\n";
-}
-
-void printSummary(const string& name, int hits, int faults, int total, double timeMs, ostream& out, ofstream& csv) {
-    double hitRate = (double)hits / total * 100.0;
-    double missRate = (double)faults / total * 100.0;
-
-    out << "\n========== " << name << " Summary ==========\n";
-    out << "Total References : " << total << "\n";
-    out << "Page Hits       : " << hits << "\n";
-    out << "Page Faults     : " << faults << "\n";
-    out << fixed << setprecision(2);
-    out << "Hit Rate        : " << hitRate << "%\n";
-    out << "Fault Rate      : " << missRate << "%\n";
-    out << "Execution Time  : " << timeMs << " ms\n";
-    out << string(40, '=') << "\n\n";
-
-    csv << name << "," << hits << "," << faults << "," << fixed << setprecision(2) << hitRate << "," << missRate << "," << timeMs << "\n";
-}
-
-// FIFO
-pair<int, int> fifo(const vector<int>& pages, int capacity, ostream& out, ofstream& csv, bool trace) {
-    unordered_set<int> s;
-    queue<int> q;
-    vector<int> frames(capacity, -1);
-    int hits = 0, faults = 0;
-
-    for (int page : pages) {
-        bool hit = s.find(page) != s.end();
-        if (hit) hits++;
-        else {
-            faults++;
-            if (s.size() == capacity) {
-                int rem = q.front(); q.pop();
-                s.erase(rem);
-                auto it = find(frames.begin(), frames.end(), rem);
-                if (it != frames.end()) *it = page;
-            } else {
-                auto it = find(frames.begin(), frames.end(), -1);
-                if (it != frames.end()) *it = page;
-            }
-            s.insert(page);
-            q.push(page);
-        }
-        if (trace) printFrames("FIFO", page, frames, hit);
-    }
-    printSummary("FIFO", hits, faults, pages.size(), 0, out, csv);
-    return {hits, faults};
-}
-
-// LRU
-pair<int, int> lru(const vector<int>& pages, int capacity, ostream& out, ofstream& csv, bool trace) {
-    list<int> lruList;
-    unordered_map<int, list<int>::iterator> pageMap;
-    vector<int> frames(capacity, -1);
-    int hits = 0, faults = 0;
-
-    for (int page : pages) {
-        bool hit = pageMap.find(page) != pageMap.end();
-        if (hit) {
-            hits++;
-            lruList.erase(pageMap[page]);
-        } else {
-            faults++;
-            if ((int)lruList.size() == capacity) {
-                int lruPage = lruList.back();
-                lruList.pop_back();
-                pageMap.erase(lruPage);
-                auto it = find(frames.begin(), frames.end(), lruPage);
-                if (it != frames.end()) *it = page;
-            } else {
-                auto it = find(frames.begin(), frames.end(), -1);
-                if (it != frames.end()) *it = page;
-            }
-        }
-        lruList.push_front(page);
-        pageMap[page] = lruList.begin();
-
-        int i = 0;
-        for (int f : lruList) {
-            if (i < capacity) frames[i++] = f;
-        }
-        while (i < capacity) frames[i++] = -1;
-
-        if (trace) printFrames("LRU", page, frames, hit);
-    }
-    printSummary("LRU", hits, faults, pages.size(), 0, out, csv);
-    return {hits, faults};
-}
-
-// Optimal
-pair<int, int> optimal(const vector<int>& pages, int capacity, ostream& out, ofstream& csv, bool trace) {
-    vector<int> frames;
-    vector<int> display(capacity, -1);
-    int hits = 0, faults = 0;
-
-    for (int i = 0; i < pages.size(); ++i) {
-        int page = pages[i];
-        auto it = find(frames.begin(), frames.end(), page);
-        bool hit = (it != frames.end());
-        if (hit) {
-            hits++;
-        } else {
-            faults++;
-            if (frames.size() < capacity) {
-                frames.push_back(page);
-                auto pit = find(display.begin(), display.end(), -1);
-                if (pit != display.end()) *pit = page;
-            } else {
-                int farthest = i + 1, index = -1;
-                for (int j = 0; j < frames.size(); j++) {
-                    int k;
-                    for (k = i + 1; k < pages.size(); k++) {
-                        if (pages[k] == frames[j]) break;
-                    }
-                    if (k > farthest) {
-                        farthest = k;
-                        index = j;
-                    }
-                }
-                if (index == -1) index = 0;
-                int victim = frames[index];
-                frames[index] = page;
-                auto it2 = find(display.begin(), display.end(), victim);
-                if (it2 != display.end()) *it2 = page;
-            }
-        }
-        if (trace) printFrames("Optimal", page, display, hit);
-    }
-    printSummary("Optimal", hits, faults, pages.size(), 0, out, csv);
-    return {hits, faults};
-}
-
-// Second Chance
-pair<int, int> secondChance(const vector<int>& pages, int capacity, ostream& out, ofstream& csv, bool trace) {
-    queue<pair<int, bool>> mem;
-    vector<int> frames(capacity, -1);
-    int hits = 0, faults = 0;
-
-    for (int page : pages) {
-        bool found = false;
-        queue<pair<int, bool>> temp;
-
-        while (!mem.empty()) {
-            pair<int, bool> front = mem.front(); mem.pop();
-            int val = front.first;
-            bool ref = front.second;
-
-            if (val == page) {
-                found = true;
-                temp.push(make_pair(val, true));
-            } else {
-                temp.push(make_pair(val, ref));
-            }
-        }
-        mem = temp;
-
-        if (found) hits++;
-        else {
-            faults++;
-            if (mem.size() == capacity) {
-                while (true) {
-                    pair<int, bool> front = mem.front(); mem.pop();
-                    int val = front.first;
-                    bool ref = front.second;
-                    if (!ref) break;
-                    mem.push(make_pair(val, false));
-                }
-            }
-            mem.push(make_pair(page, true));
-        }
-
-        vector<int> current;
-        queue<pair<int, bool>> copy = mem;
-        while (!copy.empty()) {
-            current.push_back(copy.front().first);
-            copy.pop();
-        }
-        while (current.size() < capacity) current.push_back(-1);
-
-        if (trace) printFrames("Second Chance", page, current, found);
-    }
-
-    printSummary("Second Chance", hits, faults, pages.size(), 0, out, csv);
-    return {hits, faults};
-}
-
-// LFU
-pair<int, int> lfu(const vector<int>& pages, int capacity, ostream& out, ofstream& csv, bool trace) {
-    unordered_map<int, int> freq;
-    list<int> mem;
-    vector<int> frames(capacity, -1);
-    int hits = 0, faults = 0;
-
-    for (int page : pages) {
-        bool found = find(mem.begin(), mem.end(), page) != mem.end();
-        if (found) {
-            hits++; freq[page]++;
-        } else {
-            faults++;
-            if (mem.size() == capacity) {
-                int minFreq = INT_MAX, victim = -1;
-                for (int p : mem) {
-                    if (freq[p] < minFreq) {
-                        minFreq = freq[p];
-                        victim = p;
-                    }
-                }
-                mem.remove(victim);
-                freq.erase(victim);
-                auto it = find(frames.begin(), frames.end(), victim);
-                if (it != frames.end()) *it = page;
-            } else {
-                auto it = find(frames.begin(), frames.end(), -1);
-                if (it != frames.end()) *it = page;
-            }
-            mem.push_back(page);
-            freq[page] = 1;
-        }
-
-        int i = 0;
-        for (int p : mem) {
-            if (i < capacity) frames[i++] = p;
-        }
-        while (i < capacity) frames[i++] = -1;
-
-        if (trace) printFrames("LFU", page, frames, found);
-    }
-    printSummary("LFU", hits, faults, pages.size(), 0, out, csv);
-    return {hits, faults};
-}
-
-// MFU
-pair<int, int> mfu(const vector<int>& pages, int capacity, ostream& out, ofstream& csv, bool trace) {
-    unordered_map<int, int> freq;
-    list<int> mem;
-    vector<int> frames(capacity, -1);
-    int hits = 0, faults = 0;
-
-    for (int page : pages) {
-        bool found = find(mem.begin(), mem.end(), page) != mem.end();
-        if (found) {
-            hits++; freq[page]++;
-        } else {
-            faults++;
-            if (mem.size() == capacity) {
-                int maxFreq = -1, victim = -1;
-                for (int p : mem) {
-                    if (freq[p] > maxFreq) {
-                        maxFreq = freq[p];
-                        victim = p;
-                    }
-                }
-                mem.remove(victim);
-                freq.erase(victim);
-                auto it = find(frames.begin(), frames.end(), victim);
-                if (it != frames.end()) *it = page;
-            } else {
-                auto it = find(frames.begin(), frames.end(), -1);
-                if (it != frames.end()) *it = page;
-            }
-            mem.push_back(page);
-            freq[page] = 1;
-        }
-
-        int i = 0;
-        for (int p : mem) {
-            if (i < capacity) frames[i++] = p;
-        }
-        while (i < capacity) frames[i++] = -1;
-
-        if (trace) printFrames("MFU", page, frames, found);
-    }
-    printSummary("MFU", hits, faults, pages.size(), 0, out, csv);
-    return {hits, faults};
-}
-
-// Aging
-pair<int, int> aging(const vector<int>& pages, int capacity, ostream& out, ofstream& csv, bool trace) {
-    unordered_map<int, unsigned char> counters;
-    vector<int> mem;
-    vector<int> frames(capacity, -1);
-    int hits = 0, faults = 0;
-
-    for (int page : pages) {
-        for (auto& p : mem) counters[p] >>= 1;
-
-        bool found = find(mem.begin(), mem.end(), page) != mem.end();
-        if (found) {
-            hits++; counters[page] |= 0x80;
-        } else {
-            faults++;
-            if ((int)mem.size() == capacity) {
-                int victim = mem[0];
-                for (int p : mem) {
-                    if (counters[p] < counters[victim]) victim = p;
-                }
-                mem.erase(find(mem.begin(), mem.end(), victim));
-                counters.erase(victim);
-            }
-            mem.push_back(page);
-            counters[page] = 0x80;
-        }
-
-        int i = 0;
-        for (int p : mem) {
-            if (i < capacity) frames[i++] = p;
-        }
-        while (i < capacity) frames[i++] = -1;
-
-        if (trace) printFrames("Aging", page, frames, found);
-    }
-
-    printSummary("Aging", hits, faults, pages.size(), 0, out, csv);
-    return {hits, faults};
-}
-
-// Custom Algorithm
-pair<int, int> custom(const vector<int>& pages, int capacity, ostream& out, ofstream& csv, bool trace, int ruleChoice, int windowSize) {
-    unordered_map<int, int> freq;
-    vector<int> mem;
-    vector<int> frames(capacity, -1);
-    int hits = 0, faults = 0;
-    vector<int> recentPages;
-
-    for (int i = 0; i < pages.size(); ++i) {
-        int page = pages[i];
-        bool found = find(mem.begin(), mem.end(), page) != mem.end();
-        recentPages.push_back(page);
-        if (recentPages.size() > windowSize) recentPages.erase(recentPages.begin());
-
-        if (found) {
-            hits++; 
-            freq[page]++;
-        } else {
-            faults++;
-            if (mem.size() == capacity) {
-                int victim = -1;
-                if (ruleChoice == 1) { // Evict page with fewest accesses in last windowSize steps
-                    unordered_map<int, int> windowFreq;
-                    for (int p : recentPages) windowFreq[p]++;
-                    int minFreq = INT_MAX;
-                    for (int p : mem) {
-                        int count = windowFreq.count(p) ? windowFreq[p] : 0;
-                        if (count < minFreq) {
-                            minFreq = count;
-                            victim = p;
-                        }
-                    }
-                } else if (ruleChoice == 2) { // Prioritize even-numbered pages
-                    bool hasOdd = false;
-                    for (int p : mem) {
-                        if (p % 2 != 0) {
-                            victim = p;
-                            hasOdd = true;
-                            break;
-                        }
-                    }
-                    if (!hasOdd) victim = mem[0]; // Fallback to first page if all are even
-                }
-                mem.erase(find(mem.begin(), mem.end(), victim));
-                freq.erase(victim);
-                auto it = find(frames.begin(), frames.end(), victim);
-                if (it != frames.end()) *it = page;
-            } else {
-                auto it = find(frames.begin(), frames.end(), -1);
-                if (it != frames.end()) *it = page;
-            }
-            mem.push_back(page);
-            freq[page]++;
-        }
-
-        int j = 0;
-        for (int p : mem) {
-            if (j < capacity) frames[j++] = p;
-        }
-        while (j < capacity) frames[j++] = -1;
-
-        if (trace) printFrames("Custom", page, frames, found);
-    }
-
-    string ruleName = (ruleChoice == 1) ? "Custom (Fewest in Window)" : "Custom (Even Priority)";
-    printSummary(ruleName, hits, faults, pages.size(), 0, out, csv);
-    return {hits, faults};
-}
-
-// Memory Access Patterns Detector
-string detectPattern(const vector<int>& pages) {
-    unordered_map<int, int> freq;
-    int sequentialCount = 0;
-    int uniquePages = 0;
-    double avgGap = 0.0;
-    int gaps = 0;
-
-    // Frequency and sequential analysis
-    for (int i = 0; i < pages.size(); ++i) {
-        freq[pages[i]]++;
-        if (i > 0 && (pages[i] == pages[i-1] + 1 || pages[i] == pages[i-1] - 1)) {
-            sequentialCount++;
-        }
-    }
-    uniquePages = freq.size();
-
-    // Calculate average gap between re-references
-    unordered_map<int, int> lastSeen;
-    for (int i = 0; i < pages.size(); ++i) {
-        if (lastSeen.count(pages[i])) {
-            avgGap += (i - lastSeen[pages[i]]);
-            gaps++;
-        }
-        lastSeen[pages[i]] = i;
-    }
-    avgGap = gaps > 0 ? avgGap / gaps : pages.size();
-
-    // Pattern detection logic
-    double uniqueRatio = (double)uniquePages / pages.size();
-    double seqRatio = (double)sequentialCount / (pages.size() - 1);
-
-    if (avgGap < pages.size() / 4.0 && uniqueRatio < 0.5) {
-        return "Locality-based (Optimal recommended)";
-    } else if (seqRatio > 0.7) {
-        return "Sequential (FIFO or LRU recommended)";
-    } else {
-        return "Random (Aging or Second Chance recommended)";
-    }
-}
-
-// Main
-int main() {
-    int n, capacity, choice;
-    vector<int> pages;
-
-    clearConsole();
-    cout << "===== Smart Memory Management and Algorithm Customization Simulator =====\n";
-    cout<<"Please choose between 1 and 2"<<endl;
-    cout << "1. Manual Input\n2. Auto Random Generation\nChoose Input Method: ";
-    int inputChoice; cin >> inputChoice;
-
-    if (inputChoice == 2) {
-        cout << "Number of page references: ";
-        cin >> n;
-        pages.resize(n);
-        srand(time(0));
-        for (int i = 0; i < n; ++i) pages[i] = rand() % 10;
-        cout << "Generated: ";
-        for (int x : pages) cout << x << " ";
-        cout << "\n";
-    } else {
-        cout << "Enter number of references: ";
-        cin >> n;
-        pages.resize(n);
-        cout << "Enter page references: ";
-        for (int i = 0; i < n; ++i) cin >> pages[i];
-    }
-
-    cout << "Enter number of frames: ";
-    cin >> capacity;
-
-    // Pattern Detection
-    cout << "\n=== Memory Access Pattern Analysis ===\n";
-    cout << "Detected Pattern: " << detectPattern(pages) << "\n";
-    cout << string(40, '=') << "\n";
-
-    do {
-        cout << "\n--- Menu ---\n";
-        cout << "1. FIFO\n2. LRU\n3. Optimal\n4. Second Chance\n5. LFU\n6. MFU\n7. Aging\n8. Custom Algorithm\n9. Run All + Report\n10. Clear Console\n0. Exit\n";
-        cout << "Enter your choice: ";
-        cin >> choice;
-
-        ofstream report("report.txt"), csv("report.csv");
-        csv << "Algorithm,Hits,Faults,HitRate,MissRate,ExecutionTime(ms)\n";
-
-        map<string, double> hitRates;
-        int customRule = 0, windowSize = 4;
-
-        if (choice == 8) {
-            cout << "\n=== Custom Algorithm Designer ===\n";
-            cout << "Choose eviction rule:\n";
-            cout << "1. Evict page with fewest accesses in last 4 steps\n";
-            cout << "2. Give priority to even-numbered pages\n";
-            cout << "Enter rule choice: ";
-            cin >> customRule;
-            if (customRule == 1) {
-                cout << "Enter window size for access counting (e.g., 4): ";
-                cin >> windowSize;
-            }
-        }
-
-        switch (choice) {
-            case 1: fifo(pages, capacity, cout, csv, true); break;
-            case 2: lru(pages, capacity, cout, csv, true); break;
-            case 3: optimal(pages, capacity, cout, csv, true); break;
-            case 4: secondChance(pages, capacity, cout, csv, true); break;
-            case 5: lfu(pages, capacity, cout, csv, true); break;
-            case 6: mfu(pages, capacity, cout, csv, true); break;
-            case 7: aging(pages, capacity, cout, csv, true); break;
-            case 8: custom(pages, capacity, cout, csv, true, customRule, windowSize); break;
-            case 9: {
-                auto f =fifo(pages, capacity, report, csv, false); hitRates["FIFO"] = 100.0 * f.first / pages.size();
-                auto l = lru(pages, capacity, report, csv, false); hitRates["LRU"] = 100.0 * l.first / pages.size();
-                auto o = optimal(pages, capacity, report, csv, false); hitRates["Optimal"] = 100.0 * o.first / pages.size();
-                auto s = secondChance(pages, capacity, report, csv, false); hitRates["SecondChance"] = 100.0 * s.first / pages.size();
-                auto lf = lfu(pages, capacity, report, csv, false); hitRates["LFU"] = 100.0 * lf.first / pages.size();
-                auto mf = mfu(pages, capacity, report, csv, false); hitRates["MFU"] = 100.0 * mf.first / pages.size();
-                auto ag = aging(pages, capacity, report, csv, false); hitRates["Aging"] = 100.0 * ag.first / pages.size();
-                auto cu = custom(pages, capacity, report, csv, false, 1, 4); hitRates["Custom (Fewest in Window)"] = 100.0 * cu.first / pages.size();
-                auto cu2 = custom(pages, capacity, report, csv, false, 2, 4); hitRates["Custom (Even Priority)"] = 100.0 * cu2.first / pages.size();
-
-                cout << "\n\n=== HIT RATIO GRAPH (TEXT) ===\n";
-                for (map<string, double>::iterator it = hitRates.begin(); it != hitRates.end(); ++it) {
-                    cout << setw(20) << left << it->first << " | ";
-                    int bars = (int)(it->second / 2);
-                    for (int i = 0; i < bars; ++i) cout << "#";
-                    cout << " (" << fixed << setprecision(2) << it->second << "%)\n";
-                }
-
-                double optimalRate = hitRates["Optimal"];
-                string closestAlgo;
-                double minDiff = 100.0;
-
-                for (map<string, double>::iterator it = hitRates.begin(); it != hitRates.end(); ++it) {
-                    string algo = it->first;
-                    double rate = it->second;
-                    if (algo == "Optimal") continue;
-                    double diff = abs(rate - optimalRate);
-                    if (diff < minDiff) {
-                        minDiff = diff;
-                        closestAlgo = algo;
-                    }
-                }
-
-                cout << "\n Compare with Optimal:\n";
-                cout << "Optimal Hit Rate   : " << fixed << setprecision(2) << optimalRate << "%\n";
-                cout << "Closest Algorithm  : " << closestAlgo << " (" << hitRates[closestAlgo] << "%)\n";
-
-                cout << "\n Report generated: report.txt and report.csv\n";
-                break;
-            }
-            case 10: clearConsole(); break;
-            case 0: cout << "Thanks for using the simulator!\n"; break;
-            default: cout << "Invalid choice!\n"; break;
-        }
-
-        report.close();
-        csv.close();
-    } while (choice != 0);
-
-    return 0;
-}
\ No newline at end of file
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <iomanip>
+#include <chrono>
+#include <fstream>
+#include <cstdlib>
+#include <ctime>
+#include <climits>
+#include <map>
+#include <set>
+#include <cmath>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <cctype>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <sstream>
+#include <thread>
+#include <limits>
+#include <memory>
+#include <atomic>
+#include <queue>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(OS_PROJECT_COUNTERS) && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace std;
+using namespace chrono;
+
+void clearConsole() {
+#ifdef _WIN32
+    system("cls");
+#else
+    system("clear");
+#endif
+}
+
+class PackedTrace;
+
+// References per trace block: the unit of PackedTrace compression and of the
+// block-wise loops over a PageView.
+const size_t TRACE_BLOCK = 4096;
+
+// Read-only view of a page reference string. Built from a vector or straight
+// from a memory-mapped trace file, so policies never copy the trace, or over
+// a PackedTrace, whose blocks are decoded on demand. Traces that record
+// writes carry a bitmap, one bit per reference (LSB first); without one
+// every reference is a read. begin()/end() and operator[] need an unpacked
+// view; block() and forEachPage() work on both.
+struct PageView {
+    const int* data;
+    size_t count;
+    const uint8_t* writes;
+    const PackedTrace* packed;
+    PageView() : data(nullptr), count(0), writes(nullptr), packed(nullptr) {}
+    PageView(const vector<int>& v) : data(v.data()), count(v.size()), writes(nullptr), packed(nullptr) {}
+    PageView(const int* d, size_t n, const uint8_t* w = nullptr) : data(d), count(n), writes(w), packed(nullptr) {}
+    PageView(const PackedTrace& p, const uint8_t* w);
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const int* begin() const { return data; }
+    const int* end() const { return data + count; }
+    int operator[](size_t i) const { return data[i]; }
+    bool isWrite(size_t i) const { return writes && (writes[i >> 3] >> (i & 7)) & 1; }
+
+    size_t blocks() const { return (count + TRACE_BLOCK - 1) / TRACE_BLOCK; }
+    size_t blockSize(size_t b) const { return min(TRACE_BLOCK, count - b * TRACE_BLOCK); }
+    // References of block b: read in place, or for a packed view decoded
+    // into scratch, which must hold TRACE_BLOCK ints.
+    const int* block(size_t b, int* scratch) const;
+};
+
+// Binary trace format: 8-byte magic, uint64 reference count, then that many
+// little-endian int32 page ids. The fixed-width array is used in place once
+// the file is mapped. Traces ingested from raw addresses carry a remap
+// trailer after the ids: 8-byte magic, uint32 page shift, uint32 zero,
+// uint64 entry count, then the uint64 page number behind each dense id.
+// Traces with writes end with a write section (after the remap trailer, if
+// any): 8-byte magic, uint64 reference count, then one bit per reference,
+// LSB first, set for writes.
+const char TRACE_MAGIC[8] = {'P', 'G', 'T', 'R', 'A', 'C', 'E', '1'};
+const char REMAP_MAGIC[8] = {'P', 'G', 'R', 'E', 'M', 'A', 'P', '1'};
+const char WRITE_MAGIC[8] = {'P', 'G', 'W', 'R', 'I', 'T', 'E', '1'};
+const size_t TRACE_HEADER_SIZE = 16;
+
+// Writes a binary trace in chunks, so a trace never has to be held in memory.
+// The reference count goes into the header up front; when it is not known in
+// advance, setCount() patches it once the ids are written.
+class BinaryTraceWriter {
+public:
+    bool open(const string& path, uint64_t count) {
+        out.open(path, ios::binary);
+        out.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        out.write((const char*)&count, sizeof(count));
+        return (bool)out;
+    }
+    bool write(const int* pages, size_t n) {
+        out.write((const char*)pages, n * sizeof(int));
+        return (bool)out;
+    }
+    bool setCount(uint64_t count) {
+        streampos end = out.tellp();
+        out.seekp(sizeof(TRACE_MAGIC));
+        out.write((const char*)&count, sizeof(count));
+        out.seekp(end);
+        return (bool)out;
+    }
+    // Appends the remap trailer; call after the last id.
+    bool writeRemap(uint32_t pageShift, const vector<uint64_t>& pageNumbers) {
+        uint32_t reserved = 0;
+        uint64_t entries = pageNumbers.size();
+        out.write(REMAP_MAGIC, sizeof(REMAP_MAGIC));
+        out.write((const char*)&pageShift, sizeof(pageShift));
+        out.write((const char*)&reserved, sizeof(reserved));
+        out.write((const char*)&entries, sizeof(entries));
+        out.write((const char*)pageNumbers.data(), entries * sizeof(uint64_t));
+        return (bool)out;
+    }
+    // Starts the write section; (count + 7) / 8 bitmap bytes must follow
+    // through writeBits(). Call after the ids and the remap trailer.
+    bool beginWrites(uint64_t count) {
+        out.write(WRITE_MAGIC, sizeof(WRITE_MAGIC));
+        out.write((const char*)&count, sizeof(count));
+        return (bool)out;
+    }
+    bool writeBits(const uint8_t* bytes, size_t n) {
+        out.write((const char*)bytes, n);
+        return (bool)out;
+    }
+
+private:
+    ofstream out;
+};
+
+// Reads the remap trailer of an ingested trace. False if there is none.
+bool readRemap(const string& path, uint32_t& pageShift, vector<uint64_t>& pageNumbers) {
+    ifstream in(path, ios::binary);
+    char magic[sizeof(TRACE_MAGIC)];
+    uint64_t count = 0, entries = 0;
+    in.read(magic, sizeof(magic));
+    in.read((char*)&count, sizeof(count));
+    if (!in || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0) return false;
+    in.seekg(TRACE_HEADER_SIZE + count * sizeof(int));
+    uint32_t reserved;
+    in.read(magic, sizeof(magic));
+    in.read((char*)&pageShift, sizeof(pageShift));
+    in.read((char*)&reserved, sizeof(reserved));
+    in.read((char*)&entries, sizeof(entries));
+    if (!in || memcmp(magic, REMAP_MAGIC, sizeof(magic)) != 0) return false;
+    pageNumbers.resize(entries);
+    in.read((char*)pageNumbers.data(), entries * sizeof(uint64_t));
+    return (bool)in;
+}
+
+bool writeBinaryTrace(const string& path, PageView pages) {
+    BinaryTraceWriter writer;
+    bool ok = writer.open(path, pages.size()) && writer.write(pages.data, pages.size());
+    if (ok && pages.writes) ok = writer.beginWrites(pages.size()) && writer.writeBits(pages.writes, (pages.size() + 7) / 8);
+    return ok;
+}
+
+// Reads page references from a file, FIFO or stdin ("-") in chunks of
+// whatever has arrived, so a trace of any length, or a feed that never ends,
+// is parsed in constant memory. Binary traces are recognised by their magic;
+// anything else is parsed as whitespace-separated integers, where a 'w'
+// right after a number ("12w") marks a write and 'r' a read. A number (or a
+// binary id) split across two reads carries over to the next one. Any other
+// token, or a page outside [-INT_MAX, INT_MAX] (INT_MIN is the page tables'
+// empty key), is reported with its line and column and ends the input with
+// ok() false; a binary INT_MIN id ends it the same way.
+class TraceReader {
+public:
+    TraceReader()
+        : file(nullptr), binary(false), failed(false), remaining(0), buf(1 << 16), bufPos(0), bufLen(0), bufStart(0), line(1), lineStart(0),
+          inToken(false) {}
+    ~TraceReader() { close(); }
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    bool open(const string& path) {
+        close();
+        file = (path == "-") ? stdin : fopen(path.c_str(), "rb");
+        if (!file) return false;
+        bufLen = fill(buf.data(), sizeof(TRACE_MAGIC), true);
+        binary = bufLen == sizeof(TRACE_MAGIC) && memcmp(buf.data(), TRACE_MAGIC, bufLen) == 0;
+        if (binary) {
+            if (fill((char*)&remaining, sizeof(remaining), true) != sizeof(remaining)) failed = true;
+            bufLen = 0;
+        }
+        return !failed;
+    }
+
+    // Reads up to max references into out; blocks only until some input is
+    // available. Returns 0 at end of input. If writes is given, writes[i] is
+    // set to 1 for text references marked as writes and 0 otherwise (the
+    // write section of a binary trace follows the ids and is not streamed).
+    size_t read(int* out, size_t max, uint8_t* writes = nullptr) {
+        if (binary) {
+            size_t n = readBinary(out, max);
+            if (writes) memset(writes, 0, n);
+            return n;
+        }
+        return readText(out, max, writes);
+    }
+
+    bool ok() const { return !failed; }
+
+private:
+    // The text token of a text trace; see readText().
+    struct Token {
+        uint64_t line = 0, column = 0;
+        long long value = 0;
+        int digits = 0;
+        bool negative = false, write = false, suffix = false;
+        char bad = 0; // first character that does not fit
+    };
+
+    // Reads up to n bytes. Unless `all` is set it returns as soon as a pipe
+    // has delivered anything, instead of waiting for a full buffer.
+    size_t fill(char* dst, size_t n, bool all) {
+#ifdef _WIN32
+        size_t got = fread(dst, 1, n, file);
+        if (ferror(file)) failed = true;
+        return got;
+#else
+        size_t got = 0;
+        while (got < n) {
+            ssize_t r = ::read(fileno(file), dst + got, n - got);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) {
+                if (r < 0) failed = true;
+                break;
+            }
+            got += r;
+            if (!all) break;
+        }
+        return got;
+#endif
+    }
+
+    // Stops after the header's reference count, so trailers are not read as
+    // page ids.
+    size_t readBinary(int* out, size_t max) {
+        max = min<uint64_t>(max, remaining);
+        size_t n = 0;
+        while (n == 0 && max > 0) {
+            size_t got = fill(buf.data() + bufLen, min(buf.size() - bufLen, max * sizeof(int) - bufLen), false);
+            if (got == 0) return 0; // a trailing partial id is dropped
+            bufLen += got;
+            n = bufLen / sizeof(int);
+        }
+        memcpy(out, buf.data(), n * sizeof(int));
+        size_t valid = find(out, out + n, INT_MIN) - out;
+        if (valid < n) {
+            cerr << "Reserved page id " << INT_MIN << " in binary input\n";
+            failed = true;
+            remaining = 0;
+            return valid;
+        }
+        remaining -= n;
+        bufLen -= n * sizeof(int);
+        memmove(buf.data(), buf.data() + n * sizeof(int), bufLen);
+        return n;
+    }
+
+    // The token state is copied into a local while scanning, so stores to
+    // out and writes do not force it back to memory on every character.
+    size_t readText(int* out, size_t max, uint8_t* writes) {
+        size_t n = 0;
+        Token t = token;
+        bool inToken = this->inToken;
+        while (n < max && !failed) {
+            if (bufPos == bufLen) {
+                if (n > 0) break; // hand back what we have before blocking again
+                bufStart += bufLen;
+                bufPos = 0;
+                bufLen = fill(buf.data(), buf.size(), false);
+                if (bufLen == 0) {
+                    if (inToken) endToken(t, out, writes, n);
+                    inToken = false;
+                    break;
+                }
+            }
+            const char* begin = buf.data();
+            const char* p = begin + bufPos;
+            const char* end = begin + bufLen;
+            while (p < end && n < max) {
+                char c = *p++;
+                if (c == ' ' || (c >= '\t' && c <= '\r')) {
+                    if (inToken) {
+                        inToken = false;
+                        if (!endToken(t, out, writes, n)) break;
+                    }
+                    if (c == '\n') {
+                        line++;
+                        lineStart = bufStart + (p - begin);
+                    }
+                    continue;
+                }
+                if (!inToken) {
+                    inToken = true;
+                    t = Token();
+                    t.line = line;
+                    t.column = bufStart + (p - begin) - lineStart;
+                    if (c == '-') {
+                        t.negative = true;
+                        continue;
+                    }
+                }
+                if (c >= '0' && c <= '9' && !t.suffix) {
+                    t.value = min(t.value * 10 + (c - '0'), 1LL << 32); // saturates well past INT_MAX
+                    t.digits++;
+                } else if ((c == 'w' || c == 'W' || c == 'r' || c == 'R') && t.digits > 0 && !t.suffix) {
+                    t.suffix = true;
+                    t.write = (c == 'w' || c == 'W');
+                } else if (!t.bad) {
+                    t.bad = c;
+                }
+            }
+            bufPos = p - begin;
+        }
+        token = t;
+        this->inToken = inToken;
+        return n;
+    }
+
+    // Emits a finished token; otherwise reports it, fails and returns false.
+    bool endToken(const Token& t, int* out, uint8_t* writes, size_t& n) {
+        if (t.bad || t.digits == 0 || t.value > INT_MAX) return reject(t);
+        if (writes) writes[n] = t.write;
+        out[n++] = (int)(t.negative ? -t.value : t.value);
+        return true;
+    }
+
+    bool reject(const Token& t) {
+        if (t.bad || t.digits == 0) {
+            cerr << "Malformed page reference at line " << t.line << ", column " << t.column;
+            if (t.bad) cerr << " (unexpected '" << t.bad << "')";
+            cerr << "\n";
+        } else {
+            cerr << "Page reference out of range at line " << t.line << ", column " << t.column << "\n";
+        }
+        failed = true;
+        return false;
+    }
+
+    void close() {
+        if (file && file != stdin) fclose(file);
+        file = nullptr;
+        binary = failed = false;
+        remaining = 0;
+        bufPos = bufLen = 0;
+        bufStart = lineStart = 0;
+        line = 1;
+        inToken = false;
+    }
+
+    FILE* file;
+    bool binary, failed;
+    uint64_t remaining; // binary ids left to read
+    vector<char> buf;
+    size_t bufPos, bufLen;
+    uint64_t bufStart;  // input offset of buf[0]
+    uint64_t line, lineStart; // current line and the input offset it starts at
+
+    Token token; // the text token being read, which may span reads
+    bool inToken;
+};
+
+// Packed traces
+// A trace held in memory block-compressed. References are cut into blocks
+// of TRACE_BLOCK and every block is encoded on its own, in whichever of two
+// forms comes out smaller:
+//   DELTA_VARINT  each reference minus the one before (the first minus 0),
+//                 zigzag-mapped to unsigned and written as an LEB128 varint;
+//                 one byte per reference for sequential runs and loops
+//   BIT_PACKED    frame of reference: the block minimum as a zigzag varint, a
+//                 bit width, then every reference minus the minimum in that
+//                 many bits, LSB first; bounds random references to a narrow
+//                 page range
+// Each block starts with its encoding byte, and an offset index gives random
+// access to any block, so passes can start anywhere (backwards for next
+// uses, one worker per block range) and decode only what they touch into a
+// TRACE_BLOCK buffer that stays in cache. Differences wrap in 32 bits, so
+// any int page ids round-trip.
+class PackedTrace {
+public:
+    PackedTrace() : count(0) { offsets.push_back(0); }
+
+    size_t size() const { return count; }
+    size_t blocks() const { return offsets.size() - 1; }
+    // Bytes held by the encoded blocks and the index.
+    size_t byteSize() const { return bytes.size() + offsets.size() * sizeof(uint64_t); }
+
+    // Appends n references; full blocks are encoded as they fill. Call
+    // finish() after the last one.
+    void append(const int* values, size_t n) {
+        while (n > 0) {
+            size_t take = min(n, TRACE_BLOCK - pending.size());
+            pending.insert(pending.end(), values, values + take);
+            values += take;
+            n -= take;
+            if (pending.size() == TRACE_BLOCK) {
+                appendBlock(pending.data(), pending.size());
+                pending.clear();
+            }
+        }
+    }
+
+    void finish() {
+        if (!pending.empty()) appendBlock(pending.data(), pending.size());
+        pending.clear();
+        pending.shrink_to_fit();
+        bytes.shrink_to_fit();
+        offsets.shrink_to_fit();
+    }
+
+    // Encodes n <= TRACE_BLOCK references as one block. Every block but the
+    // last must be full; tables built back to front append the short tail
+    // block first and call reverseBlocks() when done.
+    void appendBlock(const int* values, size_t n) {
+        uint32_t low = uint32_t(values[0]) ^ 0x80000000u, high = low;
+        size_t varintBytes = 1;
+        uint32_t previous = 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t v = uint32_t(values[i]);
+            varintBytes += varintSize(zigzag(v - previous));
+            previous = v;
+            low = min(low, v ^ 0x80000000u); // compare as signed
+            high = max(high, v ^ 0x80000000u);
+        }
+        uint32_t base = low ^ 0x80000000u;
+        int width = 0;
+        while (width < 32 && ((high - low) >> width) != 0) width++;
+        size_t packedBytes = 2 + varintSize(zigzag(base)) + (n * width + 7) / 8 + PACK_SLACK;
+
+        if (varintBytes <= packedBytes) {
+            bytes.push_back(DELTA_VARINT);
+            previous = 0;
+            for (size_t i = 0; i < n; ++i) {
+                putVarint(zigzag(uint32_t(values[i]) - previous));
+                previous = uint32_t(values[i]);
+            }
+        } else {
+            bytes.push_back(BIT_PACKED);
+            putVarint(zigzag(base));
+            bytes.push_back(width);
+            uint64_t acc = 0;
+            int bits = 0;
+            for (size_t i = 0; i < n; ++i) {
+                acc |= uint64_t(uint32_t(values[i]) - base) << bits;
+                bits += width;
+                while (bits >= 8) {
+                    bytes.push_back(uint8_t(acc));
+                    acc >>= 8;
+                    bits -= 8;
+                }
+            }
+            if (bits > 0) bytes.push_back(uint8_t(acc));
+            bytes.insert(bytes.end(), PACK_SLACK, 0); // lets decode read 8 bytes at a time
+        }
+        offsets.push_back(bytes.size());
+        count += n;
+    }
+
+    void reverseBlocks() {
+        vector<uint8_t> reordered;
+        reordered.reserve(bytes.size());
+        vector<uint64_t> starts(1, 0);
+        for (size_t b = blocks(); b-- > 0;) {
+            reordered.insert(reordered.end(), bytes.begin() + offsets[b], bytes.begin() + offsets[b + 1]);
+            starts.push_back(reordered.size());
+        }
+        bytes.swap(reordered);
+        offsets.swap(starts);
+    }
+
+    // Decodes block b into out (TRACE_BLOCK ints) and returns its length.
+    size_t decodeBlock(size_t b, int* out) const {
+        size_t n = min(TRACE_BLOCK, count - b * TRACE_BLOCK);
+        const uint8_t* at = bytes.data() + offsets[b];
+        if (*at++ == DELTA_VARINT) {
+            uint32_t previous = 0;
+            for (size_t i = 0; i < n; ++i) {
+                previous += unzigzag(getVarint(at));
+                out[i] = int(previous);
+            }
+        } else {
+            uint32_t base = unzigzag(getVarint(at));
+            int width = *at++;
+            uint64_t mask = (uint64_t(1) << width) - 1;
+            size_t bit = 0;
+            for (size_t i = 0; i < n; ++i, bit += width) {
+                uint64_t word;
+                memcpy(&word, at + (bit >> 3), sizeof(word));
+                out[i] = int(base + uint32_t((word >> (bit & 7)) & mask));
+            }
+        }
+        return n;
+    }
+
+private:
+    enum : uint8_t { DELTA_VARINT = 0, BIT_PACKED = 1 };
+    static const size_t PACK_SLACK = 7;
+
+    static uint32_t zigzag(uint32_t v) { return (v << 1) ^ uint32_t(int32_t(v) >> 31); }
+    static uint32_t unzigzag(uint32_t v) { return (v >> 1) ^ (0u - (v & 1)); }
+    static size_t varintSize(uint32_t v) {
+        size_t n = 1;
+        while (v >= 0x80) {
+            v >>= 7;
+            n++;
+        }
+        return n;
+    }
+
+    void putVarint(uint32_t v) {
+        while (v >= 0x80) {
+            bytes.push_back(uint8_t(v) | 0x80);
+            v >>= 7;
+        }
+        bytes.push_back(uint8_t(v));
+    }
+
+    static uint32_t getVarint(const uint8_t*& at) {
+        uint32_t v = 0;
+        for (int shift = 0;; shift += 7) {
+            uint8_t byte = *at++;
+            v |= uint32_t(byte & 0x7F) << shift;
+            if (byte < 0x80) return v;
+        }
+    }
+
+    vector<uint8_t> bytes;
+    vector<uint64_t> offsets; // block b is bytes[offsets[b], offsets[b + 1])
+    size_t count;
+    vector<int> pending;
+};
+
+PageView::PageView(const PackedTrace& p, const uint8_t* w) : data(nullptr), count(p.size()), writes(w), packed(&p) {}
+
+const int* PageView::block(size_t b, int* scratch) const {
+    if (!packed) return data + b * TRACE_BLOCK;
+    packed->decodeBlock(b, scratch);
+    return scratch;
+}
+
+// Calls visit(i, page) for every reference in order, a block at a time.
+template <class Visit>
+void forEachPage(PageView pages, Visit visit) {
+    vector<int> scratch(pages.packed ? TRACE_BLOCK : 0);
+    for (size_t b = 0; b < pages.blocks(); ++b) {
+        const int* block = pages.block(b, scratch.data());
+        size_t from = b * TRACE_BLOCK, n = pages.blockSize(b);
+        for (size_t k = 0; k < n; ++k) visit(from + k, block[k]);
+    }
+}
+
+// A loaded trace: either a mapped binary file or text parsed into memory.
+// Opened with `pack`, it is held as a PackedTrace instead: text is packed
+// chunk by chunk as it is parsed and a binary file block by block from the
+// mapping, which is released afterwards, so the raw trace is never resident
+// in full. Only the write bitmap is kept as is. Binary traces holding the
+// reserved id INT_MIN are rejected.
+class TraceFile {
+public:
+    TraceFile() : mapped(nullptr), mappedSize(0) {}
+    ~TraceFile() { close(); }
+    TraceFile(const TraceFile&) = delete;
+    TraceFile& operator=(const TraceFile&) = delete;
+
+    bool open(const string& path, bool pack = false) {
+        close();
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f) return false;
+        char magic[sizeof(TRACE_MAGIC)] = {};
+        size_t got = fread(magic, 1, sizeof(magic), f);
+        bool binary = got == sizeof(magic) && memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0;
+        fclose(f);
+        if (!binary) return parseText(path, pack);
+        if (!openBinary(path)) return false;
+        const int* reserved = find(pages.begin(), pages.end(), INT_MIN);
+        if (reserved != pages.end()) {
+            cerr << "Reserved page id " << INT_MIN << " at reference " << reserved - pages.begin() << "\n";
+            close();
+            return false;
+        }
+        if (pack) packMapped();
+        return true;
+    }
+
+    PageView view() const { return pages; }
+
+private:
+    // Finds the write bitmap in the `size` bytes that follow count ids,
+    // skipping a remap trailer. Null if the trace has no write section.
+    static const uint8_t* findWrites(const char* tail, size_t size, uint64_t count) {
+        size_t at = 0;
+        if (size >= 24 && memcmp(tail, REMAP_MAGIC, sizeof(REMAP_MAGIC)) == 0) {
+            uint64_t entries;
+            memcpy(&entries, tail + 16, sizeof(entries));
+            if (entries > (size - 24) / sizeof(uint64_t)) return nullptr;
+            at = 24 + entries * sizeof(uint64_t);
+        }
+        uint64_t flagged;
+        if (at + 16 > size || memcmp(tail + at, WRITE_MAGIC, sizeof(WRITE_MAGIC)) != 0) return nullptr;
+        memcpy(&flagged, tail + at + 8, sizeof(flagged));
+        if (flagged != count || (count + 7) / 8 > size - at - 16) return nullptr;
+        return (const uint8_t*)tail + at + 16;
+    }
+
+    bool openBinary(const string& path) {
+#ifdef _WIN32
+        ifstream in(path, ios::binary);
+        uint64_t count = 0;
+        in.seekg(sizeof(TRACE_MAGIC));
+        in.read((char*)&count, sizeof(count));
+        if (!in) return false;
+        owned.resize(count);
+        in.read((char*)owned.data(), count * sizeof(int));
+        if (!in) return false;
+        pages = PageView(owned);
+        vector<char> tail((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        if (const uint8_t* bits = findWrites(tail.data(), tail.size(), count)) {
+            writeBits.assign(bits, bits + (count + 7) / 8);
+            pages.writes = writeBits.data();
+        }
+        return true;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < TRACE_HEADER_SIZE) {
+            ::close(fd);
+            return false;
+        }
+        void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) return false;
+        mapped = base;
+        mappedSize = st.st_size;
+        uint64_t count;
+        memcpy(&count, (const char*)base + sizeof(TRACE_MAGIC), sizeof(count));
+        if (count > (mappedSize - TRACE_HEADER_SIZE) / sizeof(int)) {
+            close();
+            return false;
+        }
+        madvise(base, mappedSize, MADV_SEQUENTIAL);
+        size_t idsEnd = TRACE_HEADER_SIZE + count * sizeof(int);
+        pages = PageView((const int*)((const char*)base + TRACE_HEADER_SIZE), count,
+                         findWrites((const char*)base + idsEnd, mappedSize - idsEnd, count));
+        return true;
+#endif
+    }
+
+    bool parseText(const string& path, bool pack) {
+        TraceReader reader;
+        if (!reader.open(path)) return false;
+        vector<uint8_t> flags(1 << 16);
+        vector<int> chunk(pack ? 1 << 16 : 0);
+        bool anyWrite = false;
+        size_t got, total = 0;
+        do {
+            size_t at = total;
+            if (pack) {
+                got = reader.read(chunk.data(), chunk.size(), flags.data());
+                packedTrace.append(chunk.data(), got);
+            } else {
+                owned.resize(at + (1 << 16));
+                got = reader.read(owned.data() + at, 1 << 16, flags.data());
+                owned.resize(at + got);
+            }
+            total += got;
+            writeBits.resize((total + 7) / 8, 0);
+            for (size_t i = 0; i < got; ++i) {
+                if (!flags[i]) continue;
+                writeBits[(at + i) >> 3] |= 1 << ((at + i) & 7);
+                anyWrite = true;
+            }
+        } while (got > 0);
+        if (!anyWrite) writeBits.clear();
+        if (pack) {
+            packedTrace.finish();
+            pages = PageView(packedTrace, anyWrite ? writeBits.data() : nullptr);
+        } else {
+            pages = PageView(owned.data(), owned.size(), anyWrite ? writeBits.data() : nullptr);
+        }
+        return reader.ok();
+    }
+
+    // Packs an opened binary trace and drops the mapping (or the copy).
+    void packMapped() {
+        PageView raw = pages;
+        for (size_t b = 0; b < raw.blocks(); ++b) packedTrace.appendBlock(raw.block(b, nullptr), raw.blockSize(b));
+        packedTrace.finish();
+        if (raw.writes && raw.writes != writeBits.data()) writeBits.assign(raw.writes, raw.writes + (raw.size() + 7) / 8);
+#ifndef _WIN32
+        if (mapped) munmap(mapped, mappedSize);
+#endif
+        mapped = nullptr;
+        mappedSize = 0;
+        vector<int>().swap(owned);
+        pages = PageView(packedTrace, raw.writes ? writeBits.data() : nullptr);
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (mapped) munmap(mapped, mappedSize);
+#endif
+        mapped = nullptr;
+        mappedSize = 0;
+        owned.clear();
+        writeBits.clear();
+        packedTrace = PackedTrace();
+        pages = PageView();
+    }
+
+    vector<int> owned;
+    vector<uint8_t> writeBits;
+    PackedTrace packedTrace;
+    PageView pages;
+    void* mapped;
+    size_t mappedSize;
+};
+
+// xoshiro256** (Blackman & Vigna), seeded through splitmix64.
+class Xoshiro256 {
+public:
+    explicit Xoshiro256(uint64_t seed) {
+        for (uint64_t& word : state) {
+            seed += 0x9E3779B97F4A7C15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() {
+        uint64_t result = rotl(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, range), range < 2^32, by multiply-shift.
+    uint32_t below(uint32_t range) { return (uint32_t)(((next() >> 32) * range) >> 32); }
+
+    // Uniform in [0, 1).
+    double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    uint64_t state[4];
+};
+
+// Zipf ranks in [1, n] by rejection-inversion (Hoermann & Derflinger, 1996):
+// O(1) per draw and no table, whatever the size of the page space.
+class ZipfSampler {
+public:
+    ZipfSampler(uint32_t n, double exponent) : n(n), exponent(exponent) {
+        hIntegralX1 = hIntegral(1.5) - 1.0;
+        hIntegralN = hIntegral(n + 0.5);
+        cut = 2.0 - hIntegralInverse(hIntegral(2.5) - h(2.0));
+    }
+
+    uint32_t sample(Xoshiro256& rng) const {
+        for (;;) {
+            double u = hIntegralN + rng.unit() * (hIntegralX1 - hIntegralN);
+            double x = hIntegralInverse(u);
+            double k = floor(x + 0.5);
+            if (k < 1) k = 1;
+            else if (k > n) k = n;
+            if (k - x <= cut || u >= hIntegral(k + 0.5) - h(k)) return (uint32_t)k;
+        }
+    }
+
+private:
+    double h(double x) const { return exp(-exponent * log(x)); }
+    double hIntegral(double x) const {
+        double logX = log(x);
+        return helper2((1.0 - exponent) * logX) * logX;
+    }
+    double hIntegralInverse(double x) const {
+        double t = max(-1.0, x * (1.0 - exponent));
+        return exp(helper1(t) * x);
+    }
+    static double helper1(double x) { return fabs(x) > 1e-8 ? log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x)); }
+    static double helper2(double x) { return fabs(x) > 1e-8 ? expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x)); }
+
+    uint32_t n;
+    double exponent, hIntegralX1, hIntegralN, cut;
+};
+
+// Synthetic workload description. Page ids fall in [0, pageSpace).
+struct WorkloadSpec {
+    string kind = "uniform";   // uniform, zipf, scan, loop, phased, scan+hot
+    uint32_t pageSpace = 10;
+    uint64_t seed = 1;
+    double zipfExponent = 0.99;
+    uint32_t loopLength = 0;   // loop: pages per iteration (0 = pageSpace / 2)
+    uint32_t workingSet = 0;   // phased: pages per phase (0 = pageSpace / 10)
+    uint64_t phaseLength = 100000; // phased: references per phase
+    double scanFraction = 0.25;    // scan+hot: share of references that scan
+    uint32_t hotPages = 0;     // scan+hot: Zipf-distributed hot set (0 = pageSpace / 10)
+    double writeFraction = 0;  // share of references that are writes (trace files only)
+};
+
+const vector<string> WORKLOAD_KINDS = {"uniform", "zipf", "scan", "loop", "phased", "scan+hot"};
+
+// Streams references for a WorkloadSpec in caller-sized chunks.
+class WorkloadGenerator {
+public:
+    explicit WorkloadGenerator(const WorkloadSpec& spec)
+        : spec(spec), rng(spec.seed), kind(kindIndex(spec.kind)),
+          space(max<uint32_t>(1, spec.pageSpace)),
+          loopLength(spec.loopLength ? min(spec.loopLength, space) : max<uint32_t>(1, space / 2)),
+          workingSet(spec.workingSet ? min(spec.workingSet, space) : max<uint32_t>(1, space / 10)),
+          hotPages(spec.hotPages ? min(spec.hotPages, space) : max<uint32_t>(1, space / 10)),
+          zipf(kind == 5 ? hotPages : space, spec.zipfExponent),
+          produced(0), cursor(0), phaseBase(0) {}
+
+    bool valid() const { return kind >= 0; }
+
+    // Fills out[0..n) with the next n references.
+    void next(int* out, size_t n) {
+        for (size_t i = 0; i < n; ++i, ++produced) out[i] = draw();
+    }
+
+private:
+    static int kindIndex(const string& kind) {
+        auto it = find(WORKLOAD_KINDS.begin(), WORKLOAD_KINDS.end(), kind);
+        return it == WORKLOAD_KINDS.end() ? -1 : it - WORKLOAD_KINDS.begin();
+    }
+
+    int draw() {
+        switch (kind) {
+            case 0: return rng.below(space);
+            case 1: return zipf.sample(rng) - 1;
+            case 2: return advance(space);
+            case 3: return advance(loopLength);
+            case 4:
+                if (produced % spec.phaseLength == 0) phaseBase = rng.below(space - workingSet + 1);
+                return phaseBase + rng.below(workingSet);
+            default:
+                if (hotPages < space && rng.unit() < spec.scanFraction) return hotPages + advance(space - hotPages);
+                return zipf.sample(rng) - 1;
+        }
+    }
+
+    // Next position of a sequential sweep over [0, length).
+    int advance(uint32_t length) {
+        if (cursor >= length) cursor = 0;
+        return cursor++;
+    }
+
+    WorkloadSpec spec;
+    Xoshiro256 rng;
+    int kind;
+    uint32_t space, loopLength, workingSet, hotPages;
+    ZipfSampler zipf;
+    uint64_t produced;
+    uint32_t cursor, phaseBase;
+};
+
+vector<int> generateWorkload(const WorkloadSpec& spec, size_t count) {
+    vector<int> pages(count);
+    WorkloadGenerator gen(spec);
+    gen.next(pages.data(), count);
+    return pages;
+}
+
+// Streams count references straight into a binary trace file. With a write
+// fraction the write bitmap follows, drawn from its own generator so the page
+// ids are the same as without it.
+bool generateTraceFile(const WorkloadSpec& spec, uint64_t count, const string& path) {
+    WorkloadGenerator gen(spec);
+    BinaryTraceWriter writer;
+    if (!gen.valid() || !writer.open(path, count)) return false;
+    vector<int> chunk(1 << 20);
+    for (uint64_t done = 0; done < count;) {
+        size_t n = min<uint64_t>(chunk.size(), count - done);
+        gen.next(chunk.data(), n);
+        if (!writer.write(chunk.data(), n)) return false;
+        done += n;
+    }
+    if (spec.writeFraction <= 0) return true;
+
+    Xoshiro256 rng(spec.seed ^ 0x5752495445ull);
+    vector<uint8_t> bits(1 << 16);
+    if (!writer.beginWrites(count)) return false;
+    for (uint64_t done = 0; done < count;) {
+        size_t n = min<uint64_t>(bits.size() * 8, count - done);
+        fill(bits.begin(), bits.end(), 0);
+        for (size_t i = 0; i < n; ++i) {
+            if (rng.unit() < spec.writeFraction) bits[i >> 3] |= 1 << (i & 7);
+        }
+        if (!writer.writeBits(bits.data(), (n + 7) / 8)) return false;
+        done += n;
+    }
+    return true;
+}
+
+void printFrames(const string& algo, int page, const vector<int>& frames, bool hit, ostream& out = cout) {
+    out << "\n[" << algo << "] Page Reference: " << page << "\n";
+    out << (hit ? "  Page HIT " : "  Page FAULT ") << "\n";
+    out << "Current Frames: ";
+    for (int f : frames) {
+        if (f == -1) out << "- ";
+        else out << f << " ";
+    }
+    out << "\n" << string(40, '-') << "\n";
+}
+
+// Instrumentation
+// Built with -DOS_PROJECT_COUNTERS, policy runs count their hot-path work:
+// victim-search comparisons, page-table probes, evictions and bytes
+// allocated (every operator new while the run is active; construction is
+// not part of the run). On Linux, perf_event_open() also reads cycles,
+// instructions, LLC misses and branch misses of the running thread around
+// each run. Counts go to the thread's active RunCounters, set by a
+// CounterScope; without the define COUNT() expands to nothing and the
+// scopes are empty.
+#ifdef OS_PROJECT_COUNTERS
+const bool COUNTERS_ENABLED = true;
+#else
+const bool COUNTERS_ENABLED = false;
+#endif
+
+struct RunCounters {
+    enum Hardware { CYCLES, INSTRUCTIONS, LLC_MISSES, BRANCH_MISSES, HARDWARE_COUNT };
+    uint64_t comparisons = 0, probes = 0, evictions = 0, bytesAllocated = 0;
+    uint64_t hardware[HARDWARE_COUNT] = {};
+    bool hardwareValid = false;
+};
+
+thread_local RunCounters* activeCounters = nullptr;
+
+#ifdef OS_PROJECT_COUNTERS
+#define COUNT(field, n)                                      \
+    do {                                                     \
+        if (RunCounters* counters_ = activeCounters) counters_->field += (n); \
+    } while (0)
+
+void* operator new(size_t n) {
+    if (activeCounters) activeCounters->bytesAllocated += n;
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+// Kept out of line so GCC does not pair the inlined free() with new.
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+#else
+#define COUNT(field, n) \
+    do {                \
+    } while (0)
+#endif
+
+// The calling thread's perf_event group, opened on first use. Reads fail
+// (and runs report no hardware counts) where perf events are unavailable,
+// e.g. with a restrictive perf_event_paranoid or inside a container.
+class HardwareCounters {
+public:
+    static HardwareCounters& forThread() {
+        thread_local HardwareCounters counters;
+        return counters;
+    }
+
+    bool read(uint64_t values[RunCounters::HARDWARE_COUNT]) {
+#if defined(OS_PROJECT_COUNTERS) && defined(__linux__)
+        if (leader < 0) return false;
+        uint64_t data[1 + RunCounters::HARDWARE_COUNT];
+        if (::read(leader, data, sizeof(data)) != (ssize_t)sizeof(data) || data[0] != RunCounters::HARDWARE_COUNT) return false;
+        for (int i = 0; i < RunCounters::HARDWARE_COUNT; ++i) values[i] = data[1 + i];
+        return true;
+#else
+        (void)values;
+        return false;
+#endif
+    }
+
+private:
+#if defined(OS_PROJECT_COUNTERS) && defined(__linux__)
+    HardwareCounters() {
+        const uint64_t events[RunCounters::HARDWARE_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (int i = 0; i < RunCounters::HARDWARE_COUNT; ++i) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = events[i];
+            attr.read_format = PERF_FORMAT_GROUP;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            int fd = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+            if (fd < 0) {
+                close();
+                return;
+            }
+            fds.push_back(fd);
+            if (i == 0) leader = fd;
+        }
+    }
+
+    ~HardwareCounters() { close(); }
+
+    void close() {
+        for (int fd : fds) ::close(fd);
+        fds.clear();
+        leader = -1;
+    }
+
+    int leader = -1;
+    vector<int> fds;
+#endif
+};
+
+// Makes `counters` the thread's active counters for its lifetime and adds
+// the hardware counts spent meanwhile. Scopes nest; the outer one resumes.
+class CounterScope {
+public:
+#ifdef OS_PROJECT_COUNTERS
+    explicit CounterScope(RunCounters& counters) : counters(counters), previous(activeCounters) {
+        started = HardwareCounters::forThread().read(start);
+        activeCounters = &counters;
+    }
+
+    ~CounterScope() {
+        activeCounters = previous;
+        uint64_t end[RunCounters::HARDWARE_COUNT];
+        if (started && HardwareCounters::forThread().read(end)) {
+            for (int i = 0; i < RunCounters::HARDWARE_COUNT; ++i) counters.hardware[i] += end[i] - start[i];
+            counters.hardwareValid = true;
+        }
+    }
+
+private:
+    RunCounters& counters;
+    RunCounters* previous;
+    uint64_t start[RunCounters::HARDWARE_COUNT];
+    bool started;
+#else
+    explicit CounterScope(RunCounters&) {}
+#endif
+};
+
+// report.csv columns added by printSummary() for RunCounters.
+const char COUNTER_COLUMNS[] = ",Comparisons,Probes,Evictions,BytesAllocated,Cycles,Instructions,LLCMisses,BranchMisses";
+
+// Latency and I/O of one policy run under the cost model (see CostMeter).
+struct CostReport {
+    long long references = 0, tlbHits = 0, faults = 0, writes = 0, writeBacks = 0;
+    double totalNs = 0;
+    uint64_t pageBytes = 4096;
+
+    double eatNs() const { return references > 0 ? totalNs / references : 0.0; }
+    double tlbHitRate() const { return references > 0 ? 100.0 * tlbHits / references : 0.0; }
+    uint64_t ioBytes() const { return (faults + writeBacks) * pageBytes; }
+};
+
+// With a cost report, its latency and I/O figures follow the counts and are
+// appended to the CSV row; instrumentation counters (when compiled in) come
+// after those. Hardware columns are left empty where they were unavailable.
+void printSummary(const string& name, long long hits, long long faults, long long total, double timeMs, ostream& out, ostream& csv,
+                  const CostReport* cost = nullptr, const RunCounters* counters = nullptr) {
+    double hitRate = (double)hits / total * 100.0;
+    double missRate = (double)faults / total * 100.0;
+
+    out << "\n========== " << name << " Summary ==========\n";
+    out << "Total References : " << total << "\n";
+    out << "Page Hits       : " << hits << "\n";
+    out << "Page Faults     : " << faults << "\n";
+    out << fixed << setprecision(2);
+    out << "Hit Rate        : " << hitRate << "%\n";
+    out << "Fault Rate      : " << missRate << "%\n";
+    double nsPerRef = total > 0 ? timeMs * 1e6 / total : 0.0;
+    out << "Execution Time  : " << timeMs << " ms\n";
+    out << "Time/Reference  : " << nsPerRef << " ns\n";
+    if (cost) {
+        out << "TLB Hit Rate    : " << cost->tlbHitRate() << "%\n";
+        out << "Writes          : " << cost->writes << " (" << cost->writeBacks << " dirty write-backs)\n";
+        out << "I/O Volume      : " << cost->ioBytes() / 1048576.0 << " MiB (" << cost->faults << " pages in, "
+            << cost->writeBacks << " out)\n";
+        out << "Effective Access: " << cost->eatNs() << " ns\n";
+    }
+    if (COUNTERS_ENABLED && counters) {
+        double refs = max(1LL, total);
+        out << "Victim Search   : " << counters->comparisons << " comparisons (" << counters->comparisons / refs << "/ref), "
+            << counters->evictions << " evictions\n";
+        out << "Index Probes    : " << counters->probes << " (" << counters->probes / refs << "/ref)\n";
+        out << "Allocated       : " << counters->bytesAllocated << " bytes\n";
+        if (counters->hardwareValid) {
+            const uint64_t* hw = counters->hardware;
+            out << "Hardware        : " << hw[RunCounters::CYCLES] / refs << " cycles/ref, IPC "
+                << (double)hw[RunCounters::INSTRUCTIONS] / max<uint64_t>(1, hw[RunCounters::CYCLES]) << ", "
+                << 1000 * hw[RunCounters::LLC_MISSES] / refs << " LLC misses and " << 1000 * hw[RunCounters::BRANCH_MISSES] / refs
+                << " branch misses per 1000 refs\n";
+        } else {
+            out << "Hardware        : unavailable (perf_event_open)\n";
+        }
+    }
+    out << string(40, '=') << "\n\n";
+
+    csv << name << "," << hits << "," << faults << "," << fixed << setprecision(2) << hitRate << "," << missRate << "," << timeMs << "," << nsPerRef;
+    if (cost) csv << "," << cost->eatNs() << "," << cost->tlbHitRate() << "," << cost->writeBacks << "," << cost->ioBytes();
+    if (COUNTERS_ENABLED && counters) {
+        csv << "," << counters->comparisons << "," << counters->probes << "," << counters->evictions << "," << counters->bytesAllocated;
+        for (uint64_t v : counters->hardware) {
+            csv << ",";
+            if (counters->hardwareValid) csv << v;
+        }
+    }
+    csv << "\n";
+}
+
+// Open-addressing page -> value table (linear probing, backward-shift
+// deletion, Fibonacci hashing). Keys and values sit in two flat arrays that
+// are kept at most half full, so lookups touch one or two cache lines and
+// nothing is allocated unless the table has to grow. Values must be >= 0.
+// Key is int for page ids (INT_MIN is reserved as the empty-key marker) or
+// uint64_t for raw page numbers (UINT64_MAX is reserved).
+template <class Key>
+class BasicPageTable {
+public:
+    explicit BasicPageTable(size_t expected = 8) : count(0) { rehash(expected); }
+
+    // Value stored for page, or -1.
+    int find(Key page) const {
+        for (size_t i = home(page);; i = (i + 1) & mask) {
+            COUNT(probes, 1);
+            if (keys[i] == page) return values[i];
+            if (keys[i] == EMPTY) return -1;
+        }
+    }
+
+    // Inserts page or overwrites its value.
+    void set(Key page, int value) {
+        size_t i = home(page);
+        for (; keys[i] != EMPTY; i = (i + 1) & mask) {
+            COUNT(probes, 1);
+            if (keys[i] == page) {
+                values[i] = value;
+                return;
+            }
+        }
+        if ((count + 1) * 2 > keys.size()) {
+            rehash(keys.size());
+            set(page, value);
+            return;
+        }
+        keys[i] = page;
+        values[i] = value;
+        count++;
+    }
+
+    void erase(Key page) {
+        size_t i = home(page);
+        while (keys[i] != page) {
+            COUNT(probes, 1);
+            if (keys[i] == EMPTY) return;
+            i = (i + 1) & mask;
+        }
+        // Pull later entries of the probe run back so no tombstones are needed.
+        for (size_t j = (i + 1) & mask; keys[j] != EMPTY; j = (j + 1) & mask) {
+            size_t h = home(keys[j]);
+            bool movable = (i <= j) ? (h <= i || h > j) : (h <= i && h > j);
+            if (movable) {
+                keys[i] = keys[j];
+                values[i] = values[j];
+                i = j;
+            }
+        }
+        keys[i] = EMPTY;
+        count--;
+    }
+
+    size_t size() const { return count; }
+
+private:
+    static constexpr Key EMPTY = numeric_limits<Key>::is_signed ? numeric_limits<Key>::min() : numeric_limits<Key>::max();
+    static constexpr bool WIDE = sizeof(Key) > 4;
+
+    size_t home(Key page) const {
+        if (WIDE) return (uint64_t(page) * 0x9E3779B97F4A7C15ull) >> shift;
+        return (uint32_t(page) * 2654435769u) >> shift;
+    }
+
+    // Resizes to the smallest power of two holding 2 * entries (at least 16).
+    void rehash(size_t entries) {
+        size_t size = 16;
+        int bits = 4;
+        while (size < entries * 2) {
+            size <<= 1;
+            bits++;
+        }
+        vector<Key> oldKeys(size, EMPTY);
+        vector<int> oldValues(size);
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+        mask = size - 1;
+        shift = (WIDE ? 64 : 32) - bits;
+        count = 0;
+        for (size_t i = 0; i < oldKeys.size(); ++i) {
+            if (oldKeys[i] != EMPTY) set(oldKeys[i], oldValues[i]);
+        }
+    }
+
+    vector<Key> keys;
+    vector<int> values;
+    size_t count, mask;
+    int shift;
+};
+
+typedef BasicPageTable<int> PageTable;
+
+// Frame event log
+// Traced runs record one fixed-size event per reference instead of printing
+// the frame view. Every traced run gets a channel with its own single-
+// producer/single-consumer ring; a writer thread drains the rings into the
+// log file, so the simulation only ever stores into memory. decodeEventLog()
+// turns the log back into printFrames() output.
+//
+// Log format: 8-byte magic, then records, each starting with a uint32 tag:
+//   EVENT_CHANNEL_TAG, uint32 channel, int32 frames, uint32 name length, name
+//   uint32 channel (< CHANNEL_TAG), uint32 n, then n FrameEvents
+// A SYNC event sets a slot to the page it holds after the reference it
+// precedes; they restate slots changed by unrecorded references, so
+// sampled logs still decode to exact frame views.
+const char EVENT_MAGIC[8] = {'P', 'G', 'E', 'V', 'E', 'N', 'T', '1'};
+const uint32_t EVENT_CHANNEL_TAG = 0xFFFFFFFF;
+
+struct FrameEvent {
+    enum Flags : uint32_t { HIT = 1, SYNC = 2 };
+    uint64_t reference; // index in the trace
+    int32_t page;
+    int32_t slot;       // frame holding the page, -1 on an unsampled hit slot
+    int32_t victim;     // page the fault evicted, -1 if the frame was free
+    uint32_t flags;
+};
+
+// Lock-free ring with one producer and one consumer. Indices only grow; the
+// producer publishes with a release store of head, the consumer frees space
+// with a release store of tail.
+class EventRing {
+public:
+    static constexpr size_t SIZE = 1 << 16;
+
+    EventRing() : events(SIZE), head(0), tail(0) {}
+
+    // Waits for space rather than dropping events.
+    void push(const FrameEvent& e) {
+        size_t h = head.load(memory_order_relaxed);
+        while (h - tail.load(memory_order_acquire) == SIZE) this_thread::yield();
+        events[h & (SIZE - 1)] = e;
+        head.store(h + 1, memory_order_release);
+    }
+
+    // Hands the contiguous run of pending events to sink; returns its length.
+    template <class Sink>
+    size_t drain(Sink sink) {
+        size_t t = tail.load(memory_order_relaxed), h = head.load(memory_order_acquire);
+        size_t n = min(h - t, SIZE - (t & (SIZE - 1)));
+        if (n > 0) {
+            sink(&events[t & (SIZE - 1)], n);
+            tail.store(t + n, memory_order_release);
+        }
+        return n;
+    }
+
+private:
+    vector<FrameEvent> events;
+    alignas(64) atomic<size_t> head;
+    alignas(64) atomic<size_t> tail;
+};
+
+// Which references a channel records: all of them, every Nth, or faults.
+struct EventSampling {
+    uint64_t every = 1;
+    bool faultsOnly = false;
+};
+
+class EventLog {
+public:
+    struct Channel {
+        uint32_t id;
+        string name;
+        int frames;
+        EventRing ring;
+        bool announced = false;
+    };
+
+    ~EventLog() { close(); }
+
+    bool open(const string& path, EventSampling sampling) {
+        close();
+        out.open(path, ios::binary);
+        if (!out) return false;
+        out.write(EVENT_MAGIC, sizeof(EVENT_MAGIC));
+        this->sampling = sampling;
+        stopping = false;
+        writer = thread([this] { drainLoop(); });
+        return true;
+    }
+
+    bool isOpen() const { return writer.joinable(); }
+    EventSampling samplingMode() const { return sampling; }
+
+    Channel* channel(const string& name, int frames) {
+        lock_guard<mutex> guard(lock);
+        channels.emplace_back(new Channel);
+        Channel* c = channels.back().get();
+        c->id = channels.size() - 1;
+        c->name = name;
+        c->frames = frames;
+        return c;
+    }
+
+    // Drains every channel, stops the writer and closes the file.
+    bool close() {
+        if (!writer.joinable()) return true;
+        stopping = true;
+        writer.join();
+        channels.clear();
+        out.close();
+        return !out.fail();
+    }
+
+private:
+    void drainLoop() {
+        for (;;) {
+            bool finishing = stopping.load(memory_order_acquire);
+            size_t moved = 0;
+            {
+                lock_guard<mutex> guard(lock);
+                for (auto& c : channels) moved += drain(*c);
+            }
+            if (finishing && moved == 0) break;
+            if (moved == 0) this_thread::sleep_for(microseconds(100));
+        }
+        out.flush();
+    }
+
+    size_t drain(Channel& c) {
+        if (!c.announced) {
+            uint32_t tag = EVENT_CHANNEL_TAG, length = c.name.size();
+            int32_t frames = c.frames;
+            out.write((const char*)&tag, sizeof(tag));
+            out.write((const char*)&c.id, sizeof(c.id));
+            out.write((const char*)&frames, sizeof(frames));
+            out.write((const char*)&length, sizeof(length));
+            out.write(c.name.data(), length);
+            c.announced = true;
+        }
+        size_t total = 0;
+        for (size_t n; (n = c.ring.drain([this, &c](const FrameEvent* e, size_t n) {
+                 uint32_t count = n;
+                 out.write((const char*)&c.id, sizeof(c.id));
+                 out.write((const char*)&count, sizeof(count));
+                 out.write((const char*)e, n * sizeof(FrameEvent));
+             })) > 0;) {
+            total += n;
+        }
+        return total;
+    }
+
+    ofstream out;
+    EventSampling sampling;
+    thread writer;
+    atomic<bool> stopping{false};
+    mutex lock;
+    vector<unique_ptr<Channel>> channels;
+};
+
+// Traces up to this long are decoded onto the console after a traced run.
+const size_t SHOW_FRAMES_UP_TO = 200;
+
+// The log traced runs write to while it is open; see simulate().
+EventLog& frameLog() {
+    static EventLog log;
+    return log;
+}
+
+// Slot the latest fault loaded its page into and the page it evicted (-1
+// when the frame was free), as reported by a policy's lastLoad().
+struct FrameChange {
+    int slot = -1, victim = -1;
+};
+
+// Producer side of a channel. Faults come with the slot and victim the
+// policy reports, and a page -> slot table kept from them gives the slot of
+// recorded hits, so a reference costs O(1) however many frames there are.
+// Slots changed by faults that sampling skipped, or every slot of a view
+// that moved (Adaptive swapping its real policy, which rebuilds the table),
+// are restated by SYNC events before the next recorded event.
+class FrameTracer {
+public:
+    FrameTracer(EventLog& log, const string& name, int frames)
+        : channel(log.channel(name, frames)), sampling(log.samplingMode()), view(nullptr), slots(frames) {}
+
+    void record(uint64_t reference, int page, bool hit, const vector<int>& frames, FrameChange loaded) {
+        bool sampled = sampling.faultsOnly ? !hit : reference % sampling.every == 0;
+        int slot = -1, victim = -1;
+        if (!view) {
+            view = frames.data();
+            stale.assign(frames.size(), 0);
+        }
+        if (frames.data() != view || frames.size() != stale.size()) {
+            view = frames.data();
+            stale.assign(frames.size(), 0);
+            staleSlots.clear();
+            slots = PageTable(frames.size());
+            for (size_t s = 0; s < frames.size(); ++s) {
+                if (frames[s] != -1) slots.set(frames[s], s);
+                markStale(s);
+            }
+        } else if (!hit) {
+            slot = loaded.slot;
+            victim = loaded.victim;
+            if (victim != -1) slots.erase(victim);
+            slots.set(page, slot);
+            if (!sampled) markStale(slot);
+        }
+        if (!sampled) return;
+        if (slot < 0) slot = slots.find(page);
+        for (int s : staleSlots) {
+            channel->ring.push({reference, frames[s], s, -1, (uint32_t)FrameEvent::SYNC});
+            stale[s] = 0;
+        }
+        staleSlots.clear();
+        channel->ring.push({reference, page, slot, victim, hit ? (uint32_t)FrameEvent::HIT : 0u});
+    }
+
+private:
+    void markStale(int slot) {
+        if (stale[slot]) return;
+        stale[slot] = 1;
+        staleSlots.push_back(slot);
+    }
+
+    EventLog::Channel* channel;
+    EventSampling sampling;
+    const int* view;
+    PageTable slots; // page -> slot of the recorded view
+    vector<int> staleSlots;
+    vector<char> stale;
+};
+
+// Replays an event log as the printFrames() blocks of the recorded
+// references, channel by channel in the order they were written. Lengths
+// read from the log are checked against what is left of the file before
+// anything is allocated, so a truncated or corrupt log is rejected.
+bool decodeEventLog(const string& path, ostream& out) {
+    ifstream in(path, ios::binary | ios::ate);
+    streamoff fileSize = in.tellg();
+    in.seekg(0);
+    auto remaining = [&in, fileSize] { return (uint64_t)max<streamoff>(0, fileSize - (streamoff)in.tellg()); };
+    char magic[sizeof(EVENT_MAGIC)];
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, EVENT_MAGIC, sizeof(magic)) != 0) return false;
+    map<uint32_t, pair<string, vector<int>>> channels;
+    vector<FrameEvent> events;
+    for (uint32_t tag; in.read((char*)&tag, sizeof(tag));) {
+        if (tag == EVENT_CHANNEL_TAG) {
+            uint32_t id, length;
+            int32_t frames;
+            in.read((char*)&id, sizeof(id));
+            in.read((char*)&frames, sizeof(frames));
+            in.read((char*)&length, sizeof(length));
+            if (!in || length > remaining()) return false;
+            string name(length, ' ');
+            in.read(&name[0], length);
+            if (!in || frames < 0) return false;
+            channels[id] = {name, vector<int>(frames, -1)};
+            continue;
+        }
+        uint32_t n;
+        in.read((char*)&n, sizeof(n));
+        if (!in || n > remaining() / sizeof(FrameEvent)) return false;
+        events.resize(n);
+        in.read((char*)events.data(), n * sizeof(FrameEvent));
+        map<uint32_t, pair<string, vector<int>>>::iterator c = channels.find(tag);
+        if (!in || c == channels.end()) return false;
+        vector<int>& frames = c->second.second;
+        for (const FrameEvent& e : events) {
+            bool hit = e.flags & FrameEvent::HIT;
+            if (!hit && e.slot >= 0 && e.slot < (int)frames.size()) frames[e.slot] = e.page;
+            if (!(e.flags & FrameEvent::SYNC)) printFrames(c->second.first, e.page, frames, hit, out);
+        }
+    }
+    return in.eof();
+}
+
+// Binary heap of frame slots with a slot -> heap position index, so the key
+// of any queued slot can change in O(log capacity). Before(a, b) is true when
+// key a belongs nearer the top.
+template <class Key, class Before>
+class SlotHeap {
+public:
+    explicit SlotHeap(int capacity = 0) : pos(capacity, -1), keys(capacity) { heap.reserve(capacity); }
+
+    bool empty() const { return heap.empty(); }
+    int top() const { return heap[0]; }
+    const Key& topKey() const { return keys[heap[0]]; }
+
+    void push(int slot, const Key& key) {
+        keys[slot] = key;
+        pos[slot] = heap.size();
+        heap.push_back(slot);
+        siftUp(pos[slot]);
+    }
+
+    void update(int slot, const Key& key) {
+        keys[slot] = key;
+        siftUp(pos[slot]);
+        siftDown(pos[slot]);
+    }
+
+    void remove(int slot) {
+        int i = pos[slot], last = heap.back();
+        heap.pop_back();
+        pos[slot] = -1;
+        if (last == slot) return;
+        heap[i] = last;
+        pos[last] = i;
+        siftUp(i);
+        siftDown(pos[last]);
+    }
+
+private:
+    bool before(int a, int b) const {
+        COUNT(comparisons, 1);
+        return Before()(keys[a], keys[b]);
+    }
+
+    void swapAt(int i, int j) {
+        swap(heap[i], heap[j]);
+        pos[heap[i]] = i;
+        pos[heap[j]] = j;
+    }
+
+    void siftUp(int i) {
+        while (i > 0) {
+            int parent = (i - 1) / 2;
+            if (!before(heap[i], heap[parent])) break;
+            swapAt(i, parent);
+            i = parent;
+        }
+    }
+
+    void siftDown(int i) {
+        int n = heap.size();
+        for (;;) {
+            int best = i, l = 2 * i + 1, r = l + 1;
+            if (l < n && before(heap[l], heap[best])) best = l;
+            if (r < n && before(heap[r], heap[best])) best = r;
+            if (best == i) break;
+            swapAt(i, best);
+            i = best;
+        }
+    }
+
+    vector<int> heap, pos;
+    vector<Key> keys;
+};
+
+// Doubly-linked list of slot ids threaded through flat prev/next arrays.
+class SlotList {
+public:
+    explicit SlotList(int capacity = 0) : prev(capacity, -1), next(capacity, -1), linked(capacity, 0), head(-1), tail(-1), count(0) {}
+
+    int front() const { return head; }
+    int back() const { return tail; }
+    int after(int slot) const { return next[slot]; }
+    bool empty() const { return count == 0; }
+    int size() const { return count; }
+    bool contains(int slot) const { return linked[slot] != 0; }
+
+    void pushFront(int slot) {
+        prev[slot] = -1;
+        next[slot] = head;
+        if (head >= 0) prev[head] = slot;
+        else tail = slot;
+        head = slot;
+        linked[slot] = 1;
+        count++;
+    }
+
+    void pushBack(int slot) {
+        next[slot] = -1;
+        prev[slot] = tail;
+        if (tail >= 0) next[tail] = slot;
+        else head = slot;
+        tail = slot;
+        linked[slot] = 1;
+        count++;
+    }
+
+    void remove(int slot) {
+        if (prev[slot] >= 0) next[prev[slot]] = next[slot];
+        else head = next[slot];
+        if (next[slot] >= 0) prev[next[slot]] = prev[slot];
+        else tail = prev[slot];
+        linked[slot] = 0;
+        count--;
+    }
+
+    void moveToFront(int slot) {
+        remove(slot);
+        pushFront(slot);
+    }
+
+private:
+    vector<int> prev, next;
+    vector<char> linked;
+    int head, tail, count;
+};
+
+// Resident set shared by the policies: a slot -> page frame array plus a
+// page -> slot table. Free frames are handed out in slot order.
+class ResidentFrames {
+public:
+    explicit ResidentFrames(int capacity) : pages(capacity, -1), table(capacity), used(0) {}
+
+    int slotOf(int page) const { return table.find(page); }
+    int pageAt(int slot) const { return pages[slot]; }
+    int capacity() const { return pages.size(); }
+    bool full() const { return used == (int)pages.size(); }
+    const vector<int>& view() const { return pages; }
+
+    FrameChange lastLoad() const { return loaded; }
+
+    // Loads page into the next free frame and returns its slot.
+    int load(int page) {
+        int slot = used++;
+        pages[slot] = page;
+        table.set(page, slot);
+        loaded = {slot, -1};
+        return slot;
+    }
+
+    // Replaces the page in slot and returns the evicted page.
+    int replace(int slot, int page) {
+        COUNT(evictions, 1);
+        int victim = pages[slot];
+        table.erase(victim);
+        pages[slot] = page;
+        table.set(page, slot);
+        loaded = {slot, victim};
+        return victim;
+    }
+
+private:
+    vector<int> pages;
+    PageTable table;
+    int used;
+    FrameChange loaded;
+};
+
+// Recency-ordered history of non-resident pages (most recent at the front)
+// for the adaptive policies. Pages sit in a fixed pool of `limit` nodes with a
+// page -> node table, so lookups, inserts and removals are O(1); callers trim
+// with popBack() before pushing into a full list.
+class GhostList {
+public:
+    explicit GhostList(int limit) : order(limit), nodePage(limit, -1), index(limit) {
+        for (int n = limit - 1; n >= 0; --n) freeNodes.push_back(n);
+    }
+
+    bool contains(int page) const { return index.find(page) >= 0; }
+    int size() const { return order.size(); }
+    bool full() const { return freeNodes.empty(); }
+
+    void pushFront(int page) {
+        int n = freeNodes.back();
+        freeNodes.pop_back();
+        nodePage[n] = page;
+        index.set(page, n);
+        order.pushFront(n);
+    }
+
+    void remove(int page) {
+        int n = index.find(page);
+        if (n >= 0) release(n);
+    }
+
+    // Forgets the least recent page.
+    void popBack() {
+        if (!order.empty()) release(order.back());
+    }
+
+private:
+    void release(int n) {
+        order.remove(n);
+        index.erase(nodePage[n]);
+        freeNodes.push_back(n);
+    }
+
+    SlotList order;
+    vector<int> nodePage, freeNodes;
+    PageTable index;
+};
+
+// Latency cost model
+// Turns the hit/fault sequence of a policy into time. Every reference goes
+// through a set-associative TLB; a TLB miss costs a page walk of walkLevels
+// memory accesses, every access one memory access, and a page fault the walk
+// plus a service time drawn from a distribution. A write dirties its page,
+// and evicting a dirty page costs one more page I/O (the write-back). The
+// effective access time (EAT) is the mean time per reference.
+
+// "100", "100ns", "2.5us", "8ms", "1s" -> nanoseconds; false if malformed.
+bool parseDuration(const string& text, double& ns) {
+    char* end;
+    double value = strtod(text.c_str(), &end);
+    string unit(end);
+    double scale = unit.empty() || unit == "ns" ? 1 : unit == "us" ? 1e3 : unit == "ms" ? 1e6 : unit == "s" ? 1e9 : -1;
+    if (end == text.c_str() || scale < 0 || value < 0) return false;
+    ns = value * scale;
+    return true;
+}
+
+// Service time of one page I/O: "8ms" (fixed), "uniform:2ms,12ms",
+// "exp:8ms" (exponential with that mean) or "lognormal:8ms,0.5" (median
+// and the sigma of the underlying normal).
+struct ServiceTime {
+    enum Kind { FIXED, UNIFORM, EXPONENTIAL, LOGNORMAL };
+    Kind kind = FIXED;
+    double a = 8e6, b = 0; // ns, except a lognormal's sigma
+
+    double sample(Xoshiro256& rng) const {
+        switch (kind) {
+            case FIXED: return a;
+            case UNIFORM: return a + (b - a) * rng.unit();
+            case EXPONENTIAL: return -a * log(1.0 - rng.unit());
+            default: {
+                double z = sqrt(-2.0 * log(1.0 - rng.unit())) * cos(6.283185307179586 * rng.unit());
+                return a * exp(b * z);
+            }
+        }
+    }
+
+    string describe() const {
+        ostringstream s;
+        s << fixed << setprecision(3);
+        switch (kind) {
+            case FIXED: s << a / 1e6 << " ms"; break;
+            case UNIFORM: s << "uniform " << a / 1e6 << "-" << b / 1e6 << " ms"; break;
+            case EXPONENTIAL: s << "exponential, mean " << a / 1e6 << " ms"; break;
+            default: s << "lognormal, median " << a / 1e6 << " ms, sigma " << b; break;
+        }
+        return s.str();
+    }
+};
+
+bool parseServiceTime(const string& text, ServiceTime& t) {
+    size_t colon = text.find(':');
+    string kind = colon == string::npos ? "fixed" : text.substr(0, colon);
+    string rest = colon == string::npos ? text : text.substr(colon + 1);
+    size_t comma = rest.find(',');
+    string first = rest.substr(0, comma), second = comma == string::npos ? "" : rest.substr(comma + 1);
+    if (kind == "fixed" && second.empty()) {
+        t.kind = ServiceTime::FIXED;
+        return parseDuration(first, t.a);
+    }
+    if (kind == "exp" && second.empty()) {
+        t.kind = ServiceTime::EXPONENTIAL;
+        return parseDuration(first, t.a);
+    }
+    if (kind == "uniform") {
+        t.kind = ServiceTime::UNIFORM;
+        return parseDuration(first, t.a) && parseDuration(second, t.b) && t.a <= t.b;
+    }
+    if (kind == "lognormal") {
+        t.kind = ServiceTime::LOGNORMAL;
+        char* end;
+        t.b = strtod(second.c_str(), &end);
+        return parseDuration(first, t.a) && !second.empty() && *end == '\0' && t.b >= 0;
+    }
+    return false;
+}
+
+struct CostModel {
+    int tlbEntries = 64;      // 0 = no TLB, every reference walks
+    int tlbWays = 4;          // tlbEntries for a fully associative TLB
+    string tlbPolicy = "lru"; // lru, fifo or random within a set
+    double tlbNs = 1;
+    double memoryNs = 100;
+    int walkLevels = 4;       // memory accesses per page walk
+    ServiceTime fault;
+    ServiceTime writeBack;
+    bool writeBackSet = false; // otherwise write-backs take the fault time
+    uint64_t pageBytes = 4096;
+
+    string describe() const {
+        ostringstream s;
+        s << "TLB " << tlbEntries << " entries, " << min(max(1, tlbWays), max(1, tlbEntries)) << "-way " << tlbPolicy << ", " << tlbNs
+          << " ns; memory " << memoryNs << " ns, " << walkLevels << "-level walk; fault " << fault.describe()
+          << "; write-back " << (writeBackSet ? writeBack : fault).describe() << "; " << pageBytes << "-byte pages";
+        return s.str();
+    }
+};
+
+// Set-associative TLB over page ids. Sets are indexed by the low bits of the
+// page id (page % sets); a set is searched linearly, which is what hardware
+// does in parallel for its handful of ways.
+class Tlb {
+public:
+    Tlb(int entries, int ways, const string& policy)
+        : ways(min(max(1, ways), max(1, entries))), sets(max(0, entries) / this->ways), tags(sets * this->ways, EMPTY),
+          stamps(tags.size(), 0), clock(0), lru(policy == "lru"), random(policy == "random"), rng(0x544C42) {}
+
+    // True on a hit; a miss installs the translation.
+    bool lookup(int page) {
+        if (sets == 0) return false;
+        size_t base = (uint32_t(page) % sets) * ways;
+        for (int w = 0; w < ways; ++w) {
+            if (tags[base + w] == page) {
+                if (lru) stamps[base + w] = ++clock;
+                return true;
+            }
+        }
+        install(base, page);
+        return false;
+    }
+
+    // Loads the translation of a page that was just faulted in. Its old
+    // entry, if any, would have been shot down at eviction, so this is a
+    // miss even when the entry is still present.
+    void refill(int page) {
+        if (sets == 0) return;
+        size_t base = (uint32_t(page) % sets) * ways;
+        for (int w = 0; w < ways; ++w) {
+            if (tags[base + w] == page) {
+                stamps[base + w] = ++clock;
+                return;
+            }
+        }
+        install(base, page);
+    }
+
+private:
+    static constexpr int EMPTY = INT_MIN;
+
+    void install(size_t base, int page) {
+        size_t victim = base;
+        if (random && tags[base + ways - 1] != EMPTY) {
+            victim = base + rng.below(ways);
+        } else {
+            for (int w = 0; w < ways; ++w) {
+                if (tags[base + w] == EMPTY) {
+                    victim = base + w;
+                    break;
+                }
+                if (stamps[base + w] < stamps[victim]) victim = base + w;
+            }
+        }
+        tags[victim] = page;
+        stamps[victim] = ++clock;
+    }
+
+    int ways;
+    size_t sets;
+    vector<int> tags;
+    vector<uint64_t> stamps; // last use (LRU) or fill time (FIFO)
+    uint64_t clock;
+    bool lru, random;
+    Xoshiro256 rng;
+};
+
+// Applies a CostModel to one policy's outcomes, reference by reference.
+// Policies do not report their victims, so dirty pages are tracked by page:
+// a dirty page that faults again must have been written back when it was
+// evicted, and finish() charges the dirty pages that were evicted and never
+// came back. Fault and write-back times come from a fixed seed, so every
+// policy sees the same sequence of service times.
+class CostMeter {
+public:
+    explicit CostMeter(const CostModel& model)
+        : model(model), tlb(model.tlbEntries, model.tlbWays, model.tlbPolicy), rng(0x434F5354) {
+        result.pageBytes = model.pageBytes;
+    }
+
+    void record(int page, bool write, bool hit) {
+        double ns = model.tlbNs + model.memoryNs;
+        double walk = model.walkLevels * model.memoryNs;
+        result.references++;
+        if (hit) {
+            if (tlb.lookup(page)) result.tlbHits++;
+            else ns += walk;
+        } else {
+            tlb.refill(page);
+            ns += walk + model.fault.sample(rng);
+            result.faults++;
+            if (dirty.find(page) >= 0) {
+                dirty.erase(page);
+                ns += writeBack();
+            }
+        }
+        if (write) {
+            result.writes++;
+            dirty.set(page, 0);
+        }
+        result.totalNs += ns;
+    }
+
+    // Charges the write-backs of dirty pages that are no longer resident.
+    void finish(const vector<int>& resident) {
+        size_t stillDirty = 0;
+        for (int page : resident) stillDirty += page >= 0 && dirty.find(page) >= 0;
+        for (size_t i = stillDirty; i < dirty.size(); ++i) result.totalNs += writeBack();
+    }
+
+    const CostReport& report() const { return result; }
+
+private:
+    double writeBack() {
+        result.writeBacks++;
+        return (model.writeBackSet ? model.writeBack : model.fault).sample(rng);
+    }
+
+    CostModel model;
+    Tlb tlb;
+    Xoshiro256 rng;
+    PageTable dirty; // pages written since they were last loaded
+    CostReport result;
+};
+
+// Simulation core shared by every policy. A Policy provides
+//   bool access(int page)              - true on a hit; on a fault the page is
+//                                        loaded, evicting a victim if needed
+//   const vector<int>& frames() const  - slot -> page (-1 empty), for tracing
+//   FrameChange lastLoad() const       - slot and victim of the latest fault,
+//                                        for tracing
+// simulate() is instantiated per policy type, so access() is resolved and
+// inlined at compile time; the frame view is only read when tracing. A
+// traced run records into frameLog() when it is open and prints otherwise.
+// The loop is timed with a steady clock; time spent printing the trace is
+// left out, and setupMs (e.g. Optimal's next-use pass) is added in. With a
+// cost model, the outcomes of each block are replayed into a CostMeter after
+// the block, outside the timed section and the counter scope, as runSweep()
+// does.
+template <class Policy>
+pair<long long, long long> simulate(const string& name, Policy& policy, PageView pages, ostream& out, ostream& csv, bool trace,
+                                    const CostModel* cost, double setupMs = 0) {
+    long long hits = 0, faults = 0;
+    unique_ptr<FrameTracer> tracer;
+    if (trace && frameLog().isOpen()) tracer.reset(new FrameTracer(frameLog(), name, policy.frames().size()));
+    unique_ptr<CostMeter> meter;
+    if (cost) meter.reset(new CostMeter(*cost));
+    RunCounters counters;
+    steady_clock::duration printing(0), elapsed(0);
+    uint8_t hit[TRACE_BLOCK];
+    vector<int> scratch(pages.packed ? TRACE_BLOCK : 0);
+    for (size_t b = 0; b < pages.blocks(); ++b) {
+        const int* block = pages.block(b, scratch.data());
+        size_t from = b * TRACE_BLOCK, n = pages.blockSize(b);
+        {
+            CounterScope scope(counters);
+            auto start = steady_clock::now();
+            for (size_t k = 0; k < n; ++k) {
+                hit[k] = policy.access(block[k]);
+                if (hit[k]) hits++;
+                else faults++;
+                if (trace) {
+                    auto printStart = steady_clock::now();
+                    if (tracer) tracer->record(from + k, block[k], hit[k], policy.frames(), policy.lastLoad());
+                    else printFrames(name, block[k], policy.frames(), hit[k]);
+                    printing += steady_clock::now() - printStart;
+                }
+            }
+            elapsed += steady_clock::now() - start;
+        }
+        if (meter) {
+            for (size_t k = 0; k < n; ++k) meter->record(block[k], pages.isWrite(from + k), hit[k]);
+        }
+    }
+    double ms = duration<double, milli>(elapsed - printing).count();
+    if (meter) meter->finish(policy.frames());
+    printSummary(name, hits, faults, pages.size(), setupMs + ms, out, csv, meter ? &meter->report() : nullptr, &counters);
+    return {hits, faults};
+}
+
+// FIFO
+// Frames fill in slot order and are replaced in place, so the oldest page is
+// always the one under a hand that cycles through the slots.
+class FifoPolicy {
+public:
+    explicit FifoPolicy(int capacity) : mem(capacity), hand(0) {}
+
+    bool access(int page) {
+        if (mem.slotOf(page) >= 0) return true;
+        if (!mem.full()) {
+            mem.load(page);
+        } else {
+            mem.replace(hand, page);
+            hand = (hand + 1) % mem.capacity();
+        }
+        return false;
+    }
+
+    const vector<int>& frames() const { return mem.view(); }
+    FrameChange lastLoad() const { return mem.lastLoad(); }
+
+private:
+    ResidentFrames mem;
+    int hand;
+};
+
+pair<long long, long long> fifo(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost) {
+    FifoPolicy policy(capacity);
+    return simulate("FIFO", policy, pages, out, csv, trace, cost);
+}
+
+// LRU
+// Recency order is a slot list: hits move to the front, the back is evicted.
+class LruPolicy {
+public:
+    explicit LruPolicy(int capacity) : mem(capacity), recency(capacity) {}
+
+    bool access(int page) {
+        int slot = mem.slotOf(page);
+        if (slot >= 0) {
+            recency.moveToFront(slot);
+            return true;
+        }
+        if (!mem.full()) {
+            slot = mem.load(page);
+        } else {
+            slot = recency.back();
+            recency.remove(slot);
+            mem.replace(slot, page);
+        }
+        recency.pushFront(slot);
+        return false;
+    }
+
+    const vector<int>& frames() const { return mem.view(); }
+    FrameChange lastLoad() const { return mem.lastLoad(); }
+
+private:
+    ResidentFrames mem;
+    SlotList recency;
+};
+
+pair<long long, long long> lru(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost) {
+    LruPolicy policy(capacity);
+    return simulate("LRU", policy, pages, out, csv, trace, cost);
+}
+
+// Optimal (Belady): next uses come from one backward pass over the trace and
+// resident frames sit in a heap keyed on next use, so a fault costs
+// O(log capacity) instead of a rescan of the remaining trace per frame.
+// Ties (pages never used again) go to the lowest frame slot.
+const int64_t NEVER_USED = INT64_MAX;
+
+// The backward pass walks the blocks last to first and hands emit(b, next)
+// the next use of every reference in block b (NEVER_USED if none). Pages
+// get dense ids so positions can be kept in 64 bits.
+template <class Emit>
+void nextUseBlocks(PageView pages, Emit emit) {
+    vector<int> scratch(pages.packed ? TRACE_BLOCK : 0);
+    vector<int64_t> next(TRACE_BLOCK), upcoming; // upcoming: dense id -> next position
+    PageTable dense;
+    for (size_t b = pages.blocks(); b-- > 0;) {
+        const int* block = pages.block(b, scratch.data());
+        int64_t from = b * TRACE_BLOCK;
+        for (int k = pages.blockSize(b) - 1; k >= 0; --k) {
+            int id = dense.find(block[k]);
+            if (id < 0) {
+                id = upcoming.size();
+                dense.set(block[k], id);
+                upcoming.push_back(NEVER_USED);
+            }
+            next[k] = upcoming[id];
+            upcoming[id] = from + k;
+        }
+        emit(b, next.data());
+    }
+}
+
+// Next uses stored as the distance to the next use, which stays small
+// wherever reuse is local: a plain array for a plain trace, or packed in
+// turn for a packed one. 0 means never used again; distances of FAR or more
+// are stored as FAR and looked up in `far`.
+struct NextUseTable {
+    static const uint32_t FAR = UINT32_MAX;
+
+    vector<uint32_t> distances;
+    PackedTrace packedDistances;
+    bool packed = false;
+    unordered_map<int64_t, int64_t> far; // position -> next use
+
+    NextUseTable() {}
+    explicit NextUseTable(PageView pages) : packed(pages.packed != nullptr) {
+        if (!packed) distances.resize(pages.size());
+        nextUseBlocks(pages, [&](size_t b, const int64_t* next) {
+            int64_t from = b * TRACE_BLOCK;
+            int n = pages.blockSize(b);
+            uint32_t block[TRACE_BLOCK];
+            for (int k = 0; k < n; ++k) block[k] = encode(from + k, next[k]);
+            if (packed) packedDistances.appendBlock((const int*)block, n);
+            else copy(block, block + n, distances.begin() + from);
+        });
+        if (packed) packedDistances.reverseBlocks();
+    }
+
+    // Distance code for the reference at position whose page is next used
+    // at next, recording far ones.
+    uint32_t encode(int64_t position, int64_t next) {
+        if (next == NEVER_USED) return 0;
+        if (next - position >= FAR) {
+            far[position] = next;
+            return FAR;
+        }
+        return uint32_t(next - position);
+    }
+
+    int64_t decode(int64_t position, uint32_t distance) const {
+        if (distance == 0) return NEVER_USED;
+        if (distance == FAR) return far.at(position);
+        return position + distance;
+    }
+};
+
+// Reads next uses from a NextUseTable in trace order, decoding a packed
+// table one block at a time.
+class NextUseCursor {
+public:
+    explicit NextUseCursor(const NextUseTable& table) : table(&table), buffer(table.packed ? TRACE_BLOCK : 0), position(0), at(0), length(0) {}
+
+    int64_t next() {
+        uint32_t distance;
+        if (!table->packed) {
+            distance = table->distances[position];
+        } else {
+            if (at == length) {
+                length = table->packedDistances.decodeBlock(position / TRACE_BLOCK, buffer.data());
+                at = 0;
+            }
+            distance = uint32_t(buffer[at++]);
+        }
+        return table->decode(position++, distance);
+    }
+
+private:
+    const NextUseTable* table;
+    vector<int> buffer;
+    int64_t position;
+    size_t at, length;
+};
+
+class OptimalPolicy {
+public:
+    // nextUse yields the position of the next reference to the page
+    // referenced at each position; access() must be called once per
+    // position, in order.
+    OptimalPolicy(int capacity, NextUseCursor nextUse) : mem(capacity), byNextUse(capacity), nextUse(nextUse) {}
+
+    bool access(int page) {
+        Key key(nextUse.next(), 0);
+        int slot = mem.slotOf(page);
+        bool hit = slot >= 0;
+        if (hit) {
+            key.second = slot;
+            byNextUse.update(slot, key);
+        } else if (!mem.full()) {
+            key.second = slot = mem.load(page);
+            byNextUse.push(slot, key);
+        } else {
+            key.second = slot = byNextUse.top();
+            mem.replace(slot, page);
+            byNextUse.update(slot, key);
+        }
+        return hit;
+    }
+
+    const vector<int>& frames() const { return mem.view(); }
+    FrameChange lastLoad() const { return mem.lastLoad(); }
+
+private:
+    typedef pair<int64_t, int> Key; // (next use, slot)
+    struct FartherFirst {
+        bool operator()(const Key& a, const Key& b) const { return a.first != b.first ? a.first > b.first : a.second < b.second; }
+    };
+
+    ResidentFrames mem;
+    SlotHeap<Key, FartherFirst> byNextUse;
+    NextUseCursor nextUse;
+};
+
+pair<long long, long long> optimal(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost) {
+    auto start = steady_clock::now();
+    NextUseTable nextUse(pages);
+    double setupMs = duration<double, milli>(steady_clock::now() - start).count();
+    OptimalPolicy policy(capacity, NextUseCursor(nextUse));
+    return simulate("Optimal", policy, pages, out, csv, trace, cost, setupMs);
+}
+
+// Optimal with a bounded lookahead, for streams that cannot be read ahead in
+// full. Only the next `lookahead` references are buffered, and a reference is
+// decided once that many later ones have arrived (or when the stream is
+// flushed), so next uses beyond the window count as "never". Each buffered
+// reference links to the next buffered use of its page; a resident page whose
+// next use was unknown is re-keyed when that use arrives. Memory is
+// O(capacity + lookahead); with a lookahead covering the whole trace the
+// result equals optimal().
+class LookaheadOptimalPolicy {
+public:
+    LookaheadOptimalPolicy(int capacity, int lookahead)
+        : mem(capacity), byNextUse(capacity), ringPage(max(0, lookahead) + 1), ringNext(ringPage.size()),
+          pending(ringPage.size()), received(0), decided(0) {}
+
+    // Buffers page. Returns 1 (hit) or 0 (fault) for the reference that just
+    // left the lookahead window, or -1 while the window is still filling.
+    int push(int page) {
+        uint64_t pos = received++;
+        int idx = pos % ringPage.size();
+        ringPage[idx] = page;
+        ringNext[idx] = NEVER;
+        int prev = pending.find(page);
+        if (prev >= 0) {
+            ringNext[prev] = pos;
+        } else {
+            int slot = mem.slotOf(page);
+            if (slot >= 0) byNextUse.update(slot, Key(pos, slot));
+        }
+        pending.set(page, idx);
+        return received - decided == ringPage.size() ? decide() : -1;
+    }
+
+    // Decides the oldest buffered reference at end of stream; -1 once empty.
+    int flush() { return decided < received ? decide() : -1; }
+
+    const vector<int>& frames() const { return mem.view(); }
+    FrameChange lastLoad() const { return mem.lastLoad(); }
+
+private:
+    typedef pair<uint64_t, int> Key; // (next use, slot)
+    struct FartherFirst {
+        bool operator()(const Key& a, const Key& b) const { return a.first != b.first ? a.first > b.first : a.second < b.second; }
+    };
+    static constexpr uint64_t NEVER = UINT64_MAX;
+
+    int decide() {
+        int idx = decided++ % ringPage.size();
+        int page = ringPage[idx];
+        if (pending.find(page) == idx) pending.erase(page);
+        Key key(ringNext[idx], 0);
+        int slot = mem.slotOf(page);
+        bool hit = slot >= 0;
+        if (hit) {
+            key.second = slot;
+            byNextUse.update(slot, key);
+        } else if (!mem.full()) {
+            key.second = slot = mem.load(page);
+            byNextUse.push(slot, key);
+        } else {
+            key.second = slot = byNextUse.top();
+            mem.replace(slot, page);
+            byNextUse.update(slot, key);
+        }
+        return hit;
+    }
+
+    ResidentFrames mem;
+    SlotHeap<Key, FartherFirst> byNextUse;
+    vector<int> ringPage;
+    vector<uint64_t> ringNext;
+    PageTable pending; // page -> ring index of its latest undecided reference
+    uint64_t received, decided;
+};
+
+// CLOCK family: a hand sweeps the frame array, with one use counter per frame.
+// A hit only bumps the frame's counter; a fault decrements counters under the
+// hand until it finds a zero. With maxCount 1 this is classic CLOCK (Second
+// Chance); larger values give GCLOCK.
+class ClockPolicy {
+public:
+    ClockPolicy(int capacity, int maxCount) : mem(capacity), uses(capacity, 0), maxCount(maxCount), hand(0) {}
+
+    bool access(int page) {
+        int slot = mem.slotOf(page);
+        if (slot >= 0) {
+            if (uses[slot] < maxCount) uses[slot]++;
+            return true;
+        }
+        if (!mem.full()) {
+            slot = mem.load(page);
+        } else {
+            while (uses[hand] > 0) {
+                COUNT(comparisons, 1);
+                uses[hand]--;
+                hand = (hand + 1) % mem.capacity();
+            }
+            slot = hand;
+            hand = (hand + 1) % mem.capacity();
+            mem.replace(slot, page);
+        }
+        uses[slot] = 1;
+        return false;
+    }
+
+    const vector<int>& frames() const { return mem.view(); }
+    FrameChange lastLoad() const { return mem.lastLoad(); }
+
+private:
+    ResidentFrames mem;
+    vector<int> uses;
+    int maxCount, hand;
+};
+
+// Second Chance
+pair<long long, long long> secondChance(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost) {
+    ClockPolicy policy(capacity, 1);
+    return simulate("Second Chance", policy, pages, out, csv, trace, cost);
+}
+
+// GCLOCK
+const int GCLOCK_MAX_COUNT = 4;
+
+pair<long long, long long> gclock(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost) {
+    ClockPolicy policy(capacity, GCLOCK_MAX_COUNT);
+    return simulate("GCLOCK", policy, pages, out, csv, trace, cost);
+}
+
+// CLOCK-Pro (Jiang, Chen & Zhang, 2005). Resident hot pages, resident cold
+// pages and non-resident cold pages still in their test period share one
+// clock, kept as a circular list over a node pool. HAND_cold evicts cold
+// pages (promoting those re-referenced during their test period), HAND_hot
+// demotes unreferenced hot pages and ends test periods, HAND_test trims the
+// non-resident pages to at most `capacity`. The cold allocation adapts:
+// it grows when a non-resident test page is referenced again and shrinks
+// when a test period expires unused.
+class ClockProPolicy {
+public:
+    explicit ClockProPolicy(int capacity)
+        : capacity(capacity), coldTarget(1), handHot(-1), handCold(-1), handTest(-1),
+          countHot(0), countCold(0), countTest(0), used(0), index(2 * capacity + 2), pages(capacity, -1) {
+        nodes.reserve(2 * capacity + 2);
+    }
+
+    const vector<int>& frames() const { return pages; }
+    FrameChange lastLoad() const { return loaded; }
+
+    bool access(int page) {
+        int n = index.find(page);
+        if (n >= 0 && nodes[n].slot >= 0) {
+            nodes[n].ref = true;
+            return true;
+        }
+
+        int slot = (used < capacity) ? used++ : evictCold();
+        int ghost = index.find(page); // the eviction may have expired this page's test period
+        n = allocNode(page, slot);
+        if (ghost >= 0) {
+            coldTarget = min(coldTarget + 1, capacity);
+            removeNode(ghost);
+            countTest--;
+            nodes[n].hot = true;
+            countHot++;
+        } else {
+            nodes[n].test = true;
+            countCold++;
+        }
+        index.set(page, n);
+        insertAtHead(n);
+        loaded = {slot, pages[slot]};
+        pages[slot] = page;
+        while (countHot > capacity - coldTarget) runHandHot();
+        while (countTest > capacity) runHandTest();
+        return false;
+    }
+
+private:
+    struct Node {
+        int page, slot, prev, next;
+        bool hot, test, ref;
+    };
+
+    int allocNode(int page, int slot) {
+        int n;
+        if (!freeNodes.empty()) {
+            n = freeNodes.back();
+            freeNodes.pop_back();
+        } else {
+            n = nodes.size();
+            nodes.push_back(Node());
+        }
+        nodes[n] = Node{page, slot, n, n, false, false, false};
+        return n;
+    }
+
+    void unlink(int n) {
+        int next = (nodes[n].next == n) ? -1 : nodes[n].next;
+        if (handHot == n) handHot = next;
+        if (handCold == n) handCold = next;
+        if (handTest == n) handTest = next;
+        nodes[nodes[n].prev].next = nodes[n].next;
+        nodes[nodes[n].next].prev = nodes[n].prev;
+    }
+
+    void removeNode(int n) {
+        unlink(n);
+        index.erase(nodes[n].page);
+        freeNodes.push_back(n);
+    }
+
+    // The list head sits just behind HAND_hot, so the hands reach it last.
+    void insertAtHead(int n) {
+        if (handHot < 0) {
+            nodes[n].prev = nodes[n].next = n;
+            handHot = handCold = handTest = n;
+            return;
+        }
+        int tail = nodes[handHot].prev;
+        nodes[n].prev = tail;
+        nodes[n].next = handHot;
+        nodes[tail].next = n;
+        nodes[handHot].prev = n;
+    }
+
+    void moveToHead(int n) {
+        unlink(n);
+        insertAtHead(n);
+    }
+
+    void endTest(int n) {
+        nodes[n].test = false;
+        coldTarget = max(1, coldTarget - 1);
+        if (nodes[n].slot < 0) {
+            removeNode(n);
+            countTest--;
+        }
+    }
+
+    // Frees one frame and returns its slot.
+    int evictCold() {
+        for (;;) {
+            if (countCold == 0) runHandHot();
+            COUNT(comparisons, 1);
+            int n = handCold;
+            Node& node = nodes[n];
+            if (node.hot || node.slot < 0) {
+                handCold = node.next;
+            } else if (node.ref) {
+                node.ref = false;
+                if (node.test) {
+                    node.hot = true;
+                    node.test = false;
+                    countCold--;
+                    countHot++;
+                    moveToHead(n);
+                    while (countHot > capacity - coldTarget) runHandHot();
+                } else {
+                    node.test = true;
+                    moveToHead(n);
+                }
+            } else {
+                COUNT(evictions, 1);
+                int slot = node.slot;
+                node.slot = -1;
+                countCold--;
+                handCold = node.next;
+                if (node.test) countTest++;
+                else removeNode(n);
+                return slot;
+            }
+        }
+    }
+
+    // Demotes one unreferenced hot page to cold.
+    void runHandHot() {
+        for (;;) {
+            COUNT(comparisons, 1);
+            int n = handHot;
+            Node& node = nodes[n];
+            handHot = node.next;
+            if (node.hot) {
+                if (!node.ref) {
+                    node.hot = false;
+                    countHot--;
+                    countCold++;
+                    return;
+                }
+                node.ref = false;
+            } else if (node.test) {
+                endTest(n);
+            }
+        }
+    }
+
+    // Drops one non-resident page, ending test periods on the way.
+    void runHandTest() {
+        for (;;) {
+            COUNT(comparisons, 1);
+            int n = handTest;
+            handTest = nodes[n].next;
+            if (!nodes[n].hot && nodes[n].test) {
+                bool resident = nodes[n].slot >= 0;
+                endTest(n);
+                if (!resident) return;
+            }
+        }
+    }
+
+    int capacity, coldTarget;
+    int handHot, handCold, handTest;
+    int countHot, countCold, countTest, used;
+    vector<Node> nodes;
+    vector<int> freeNodes;
+    PageTable index; // page -> node
+    vector<int> pages;
+    FrameChange loaded;
+};
+
+pair<long long, long long> clockPro(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost) {
+    ClockProPolicy policy(capacity);
+    return simulate("CLOCK-Pro", policy, pages, out, csv, trace, cost);
+}
+
+// ARC (Megiddo & Modha, 2003). Resident pages are split between T1 (used
+// once recently) and T2 (used at least twice), each an LRU slot list; ghost
+// lists B1 and B2 remember pages recently evicted from them. A fault on a B1
+// page grows the target size of T1, one on a B2 page shrinks it, so the split
+// between recency and frequency follows the workload and a scan only churns
+// T1. |T1| + |B1| <= capacity and |B1| + |B2| <= capacity.
+class ArcPolicy {
+public:
+    explicit ArcPolicy(int capacity)
+        : mem(capacity), t1(capacity), t2(capacity), inT2(capacity, 0), b1(capacity), b2(capacity), target(0) {}
+
+    bool access(int page) {
+        int slot = mem.slotOf(page);
+        if (slot >= 0) {
+            if (inT2[slot]) {
+                t2.moveToFront(slot);
+            } else {
+                t1.remove(slot);
+                t2.pushFront(slot);
+                inT2[slot] = 1;
+            }
+            return true;
+        }
+
+        int capacity = mem.capacity();
+        bool ghost1 = b1.contains(page), ghost2 = !ghost1 && b2.contains(page);
+        if (ghost1) {
+            target = min(capacity, target + max(b2.size() / b1.size(), 1));
+            b1.remove(page);
+        } else if (ghost2) {
+            target = max(0, target - max(b1.size() / b2.size(), 1));
+            b2.remove(page);
+        } else if (t1.size() + b1.size() == capacity) {
+            if (t1.size() == capacity) {
+                // T1 holds every frame: its LRU page leaves without a ghost.
+                slot = t1.back();
+                t1.remove(slot);
+                mem.replace(slot, page);
+                t1.pushFront(slot);
+                return false;
+            }
+            b1.popBack();
+        } else if (t1.size() + t2.size() + b1.size() + b2.size() == 2 * capacity) {
+            b2.popBack();
+        }
+
+        slot = mem.full() ? replace(ghost2, page) : mem.load(page);
+        inT2[slot] = ghost1 || ghost2;
+        if (inT2[slot]) t2.pushFront(slot);
+        else t1.pushFront(slot);
+        return false;
+    }
+
+    const vector<int>& frames() const { return mem.view(); }
+    FrameChange lastLoad() const { return mem.lastLoad(); }
+
+private:
+    // Evicts the LRU page of T1 or T2 into its ghost list and loads page in
+    // its slot.
+    int replace(bool ghost2, int page) {
+        int slot;
+        if (t1.size() > 0 && (t1.size() > target || (ghost2 && t1.size() == target))) {
+            slot = t1.back();
+            t1.remove(slot);
+            b1.pushFront(mem.pageAt(slot));
+        } else {
+            slot = t2.back();
+            t2.remove(slot);
+            b2.pushFront(mem.pageAt(slot));
+        }
+        mem.replace(slot, page);
+        return slot;
+    }
+
+    ResidentFrames mem;
+    SlotList t1, t2;
+    vector<char> inT2;
+    GhostList b1, b2;
+    int target; // target size of T1
+};
+
+pair<long long, long long> arc(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost) {
+    ArcPolicy policy(capacity);
+    return simulate("ARC", policy, pages, out, csv, trace, cost);
+}
+
+// 2Q (Johnson & Shasha, 1994), full version. A first reference puts the page
+// in A1in, a FIFO of about a quarter of the frames; pages pushed out of it are
+// remembered in the ghost FIFO A1out (half the frame count). Only a page
+// referenced again while in A1out enters Am, the LRU main queue, so pages
+// touched once by a scan never displace the hot set.
+class TwoQPolicy {
+public:
+    explicit TwoQPolicy(int capacity)
+        : mem(capacity), a1in(capacity), am(capacity), inAm(capacity, 0), a1out(max(1, capacity / 2)), kin(max(1, capacity / 4)) {}
+
+    bool access(int page) {
+        int slot = mem.slotOf(page);
+        if (slot >= 0) {
+            if (inAm[slot]) am.moveToFront(slot);
+            return true;
+        }
+
+        bool seen = a1out.contains(page);
+        if (seen) a1out.remove(page);
+        if (!mem.full()) {
+            slot = mem.load(page);
+        } else if (a1in.size() > kin || am.empty()) {
+            slot = a1in.back();
+            a1in.remove(slot);
+            if (a1out.full()) a1out.popBack();
+            a1out.pushFront(mem.pageAt(slot));
+            mem.replace(slot, page);
+        } else {
+            slot = am.back();
+            am.remove(slot);
+            mem.replace(slot, page);
+        }
+        inAm[slot] = seen;
+        if (seen) am.pushFront(slot);
+        else a1in.pushFront(slot);
+        return false;
+    }
+
+    const vector<int>& frames() const { return mem.view(); }
+    FrameChange lastLoad() const { return mem.lastLoad(); }
+
+private:
+    ResidentFrames mem;
+    SlotList a1in, am;
+    vector<char> inAm;
+    GhostList a1out;
+    int kin;
+};
+
+pair<long long, long long> twoQ(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost) {
+    TwoQPolicy policy(capacity);
+    return simulate("2Q", policy, pages, out, csv, trace, cost);
+}
+
+// LIRS (Jiang & Zhang, 2002). Pages are ranked by inter-reference recency:
+// LIR pages hold all but about 1% of the frames and are never evicted while
+// their recency stays low; the remaining frames hold HIR pages in the FIFO
+// queue Q. Stack S keeps LIR pages and recently seen HIR pages, resident or
+// not, in recency order and is pruned so an LIR page is at its bottom. An HIR
+// page referenced again while still in S becomes LIR and the bottom LIR page
+// is demoted to Q. Non-resident entries of S are capped at `capacity`, the
+// oldest being dropped first, so S stays within 2 * capacity nodes.
+class LirsPolicy {
+public:
+    explicit LirsPolicy(int capacity)
+        : capacity(capacity), lirLimit(capacity - max(1, capacity / 100)), lirCount(0), used(0), pages(capacity, -1),
+          nodes(2 * capacity + 1), stack(nodes.size()), queue(nodes.size()), ghosts(nodes.size()), index(nodes.size()) {
+        for (int n = nodes.size() - 1; n >= 0; --n) freeNodes.push_back(n);
+    }
+
+    bool access(int page) {
+        int n = index.find(page);
+        if (n >= 0 && nodes[n].slot >= 0) {
+            if (nodes[n].lir) {
+                bool bottom = stack.back() == n;
+                stack.moveToFront(n);
+                if (bottom) prune();
+            } else if (stack.contains(n)) {
+                stack.moveToFront(n);
+                queue.remove(n);
+                promote(n);
+            } else {
+                stack.pushFront(n);
+                queue.remove(n);
+                queue.pushBack(n);
+            }
+            return true;
+        }
+
+        int slot;
+        if (used < capacity) {
+            slot = used++;
+        } else {
+            COUNT(evictions, 1);
+            int victim = queue.front();
+            queue.remove(victim);
+            slot = nodes[victim].slot;
+            nodes[victim].slot = -1;
+            if (stack.contains(victim)) {
+                ghosts.pushFront(victim);
+                if (ghosts.size() > capacity) dropGhost(ghosts.back());
+            } else {
+                release(victim);
+            }
+        }
+        loaded = {slot, pages[slot]};
+        pages[slot] = page;
+
+        n = index.find(page); // the page may have been the ghost just dropped
+        if (n >= 0) {
+            ghosts.remove(n);
+            nodes[n].slot = slot;
+            stack.moveToFront(n);
+            promote(n);
+        } else {
+            n = freeNodes.back();
+            freeNodes.pop_back();
+            nodes[n] = Node{page, slot, lirCount < lirLimit};
+            index.set(page, n);
+            stack.pushFront(n);
+            if (nodes[n].lir) lirCount++;
+            else queue.pushBack(n);
+        }
+        return false;
+    }
+
+    const vector<int>& frames() const { return pages; }
+    FrameChange lastLoad() const { return loaded; }
+
+private:
+    struct Node {
+        int page, slot; // slot -1: non-resident HIR page kept in S
+        bool lir;
+    };
+
+    // Makes n (at the top of S) LIR, demoting the bottom LIR page to Q.
+    void promote(int n) {
+        nodes[n].lir = true;
+        if (++lirCount <= lirLimit) return;
+        prune();
+        int bottom = stack.back();
+        nodes[bottom].lir = false;
+        lirCount--;
+        stack.remove(bottom);
+        queue.pushBack(bottom);
+        prune();
+    }
+
+    // Pops HIR pages off the bottom of S; non-resident ones are forgotten.
+    void prune() {
+        while (!stack.empty() && !nodes[stack.back()].lir) {
+            COUNT(comparisons, 1);
+            int n = stack.back();
+            stack.remove(n);
+            if (nodes[n].slot < 0) {
+                ghosts.remove(n);
+                release(n);
+            }
+        }
+    }
+
+    void dropGhost(int n) {
+        stack.remove(n);
+        ghosts.remove(n);
+        release(n);
+    }
+
+    void release(int n) {
+        index.erase(nodes[n].page);
+        freeNodes.push_back(n);
+    }
+
+    int capacity, lirLimit, lirCount, used;
+    vector<int> pages;
+    vector<Node> nodes;
+    SlotList stack, queue, ghosts; // over nodes; S top and newest ghost at the front, Q oldest at the front
+    vector<int> freeNodes;
+    PageTable index; // page -> node
+    FrameChange loaded;
+};
+
+pair<long long, long long> lirs(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost) {
+    LirsPolicy policy(capacity);
+    return simulate("LIRS", policy, pages, out, csv, trace, cost);
+}
+
+// CAR (Bansal & Modha, 2004): ARC's adaptation with T1 and T2 kept as clocks,
+// so a hit only sets a reference bit. The T1 hand moves referenced pages to
+// T2; the T2 hand gives them another round. Evicted pages go to the ghost
+// lists B1 and B2 as in ARC. The ghost pools hold one extra page because a
+// victim is recorded before the faulting page leaves its ghost list.
+class CarPolicy {
+public:
+    explicit CarPolicy(int capacity)
+        : mem(capacity), t1(capacity), t2(capacity), inT2(capacity, 0), referenced(capacity, 0), b1(capacity + 1), b2(capacity + 1), target(0) {}
+
+    bool access(int page) {
+        int slot = mem.slotOf(page);
+        if (slot >= 0) {
+            referenced[slot] = 1;
+            return true;
+        }
+
+        int capacity = mem.capacity();
+        bool ghost1 = b1.contains(page), ghost2 = !ghost1 && b2.contains(page);
+        if (!mem.full()) {
+            slot = mem.load(page);
+        } else {
+            slot = replace();
+            if (!ghost1 && !ghost2) {
+                if (t1.size() + b1.size() == capacity) b1.popBack();
+                else if (t1.size() + t2.size() + b1.size() + b2.size() == 2 * capacity) b2.popBack();
+            }
+            mem.replace(slot, page);
+        }
+
+        if (ghost1) {
+            target = min(capacity, target + max(b2.size() / b1.size(), 1));
+            b1.remove(page);
+        } else if (ghost2) {
+            target = max(0, target - max(b1.size() / b2.size(), 1));
+            b2.remove(page);
+        }
+        inT2[slot] = ghost1 || ghost2;
+        referenced[slot] = 0;
+        if (inT2[slot]) t2.pushBack(slot);
+        else t1.pushBack(slot);
+        return false;
+    }
+
+    const vector<int>& frames() const { return mem.view(); }
+    FrameChange lastLoad() const { return mem.lastLoad(); }
+
+private:
+    // Runs the hands until an unreferenced page is found, moves it to its
+    // ghost list and returns its slot. The clock heads are the list fronts.
+    int replace() {
+        for (;;) {
+            COUNT(comparisons, 1);
+            if (t1.size() >= max(1, target)) {
+                int slot = t1.front();
+                t1.remove(slot);
+                if (!referenced[slot]) {
+                    b1.pushFront(mem.pageAt(slot));
+                    return slot;
+                }
+                referenced[slot] = 0;
+                inT2[slot] = 1;
+                t2.pushBack(slot);
+            } else {
+                int slot = t2.front();
+                t2.remove(slot);
+                if (!referenced[slot]) {
+                    b2.pushFront(mem.pageAt(slot));
+                    return slot;
+                }
+                referenced[slot] = 0;
+                t2.pushBack(slot);
+            }
+        }
+    }
+
+    ResidentFrames mem;
+    SlotList t1, t2;
+    vector<char> inT2, referenced;
+    GhostList b1, b2;
+    int target; // target size of T1
+};
+
+pair<long long, long long> car(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost) {
+    CarPolicy policy(capacity);
+    return simulate("CAR", policy, pages, out, csv, trace, cost);
+}
+
+// LFU / MFU on frequency buckets: a list of frequency nodes in increasing
+// order, each holding its frame slots, so touching, inserting and evicting
+// are all O(1). Buckets and slot links live in flat arrays. Slots within a
+// bucket are kept in the order they reached that frequency; ties are broken
+// towards the page that has held the frequency longest. With
+// decayInterval > 0 every frequency is halved once per decayInterval
+// references, so old popularity fades out.
+class FrequencyPolicy {
+public:
+    FrequencyPolicy(int capacity, bool evictMost, int decayInterval)
+        : mem(capacity), evictMost(evictMost), decayInterval(decayInterval), refs(0),
+          prevSlot(capacity, -1), nextSlot(capacity, -1), bucketOf(capacity, -1),
+          buckets(capacity + 1), first(-1), last(-1) {
+        for (int b = capacity; b >= 0; --b) freeBuckets.push_back(b);
+    }
+
+    bool access(int page) {
+        if (decayInterval > 0 && refs > 0 && refs % decayInterval == 0) decay();
+        refs++;
+
+        int slot = mem.slotOf(page);
+        if (slot >= 0) {
+            touch(slot);
+            return true;
+        }
+        if (!mem.full()) {
+            slot = mem.load(page);
+        } else {
+            slot = buckets[evictMost ? last : first].head;
+            unlinkSlot(slot);
+            mem.replace(slot, page);
+        }
+        if (first < 0 || buckets[first].freq != 1) newBucket(1, -1);
+        appendSlot(first, slot);
+        return false;
+    }
+
+    const vector<int>& frames() const { return mem.view(); }
+    FrameChange lastLoad() const { return mem.lastLoad(); }
+
+private:
+    struct Bucket {
+        int freq, head, tail, prev, next;
+    };
+
+    // Creates a bucket after `after` (-1: at the front).
+    int newBucket(int freq, int after) {
+        int b = freeBuckets.back();
+        freeBuckets.pop_back();
+        int next = (after < 0) ? first : buckets[after].next;
+        buckets[b] = Bucket{freq, -1, -1, after, next};
+        if (after >= 0) buckets[after].next = b;
+        else first = b;
+        if (next >= 0) buckets[next].prev = b;
+        else last = b;
+        return b;
+    }
+
+    void removeBucket(int b) {
+        Bucket& k = buckets[b];
+        if (k.prev >= 0) buckets[k.prev].next = k.next;
+        else first = k.next;
+        if (k.next >= 0) buckets[k.next].prev = k.prev;
+        else last = k.prev;
+        freeBuckets.push_back(b);
+    }
+
+    void appendSlot(int b, int slot) {
+        Bucket& k = buckets[b];
+        prevSlot[slot] = k.tail;
+        nextSlot[slot] = -1;
+        if (k.tail >= 0) nextSlot[k.tail] = slot;
+        else k.head = slot;
+        k.tail = slot;
+        bucketOf[slot] = b;
+    }
+
+    // Takes slot out of its bucket, dropping the bucket once it is empty.
+    void unlinkSlot(int slot) {
+        int b = bucketOf[slot];
+        Bucket& k = buckets[b];
+        if (prevSlot[slot] >= 0) nextSlot[prevSlot[slot]] = nextSlot[slot];
+        else k.head = nextSlot[slot];
+        if (nextSlot[slot] >= 0) prevSlot[nextSlot[slot]] = prevSlot[slot];
+        else k.tail = prevSlot[slot];
+        if (k.head < 0) removeBucket(b);
+    }
+
+    void touch(int slot) {
+        int b = bucketOf[slot], freq = buckets[b].freq;
+        int next = buckets[b].next;
+        if (next < 0 || buckets[next].freq != freq + 1) next = newBucket(freq + 1, b);
+        unlinkSlot(slot);
+        appendSlot(next, slot);
+    }
+
+    // Halves every frequency (never below 1). Buckets that collapse onto the
+    // same frequency are merged, lower original frequency first.
+    void decay() {
+        for (int b = first; b >= 0;) {
+            int next = buckets[b].next;
+            buckets[b].freq = max(1, buckets[b].freq / 2);
+            int before = buckets[b].prev;
+            if (before >= 0 && buckets[before].freq == buckets[b].freq) {
+                for (int s = buckets[b].head; s >= 0;) {
+                    int following = nextSlot[s];
+                    appendSlot(before, s);
+                    s = following;
+                }
+                removeBucket(b);
+            }
+            b = next;
+        }
+    }
+
+    ResidentFrames mem;
+    bool evictMost;
+    int decayInterval;
+    long long refs;
+    vector<int> prevSlot, nextSlot, bucketOf;
+    vector<Bucket> buckets;
+    vector<int> freeBuckets;
+    int first, last;
+};
+
+// LFU
+pair<long long, long long> lfu(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost, int decayInterval = 0) {
+    string name = decayInterval > 0 ? "LFU (Decay " + to_string(decayInterval) + ")" : "LFU";
+    FrequencyPolicy policy(capacity, false, decayInterval);
+    return simulate(name, policy, pages, out, csv, trace, cost);
+}
+
+// MFU
+pair<long long, long long> mfu(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost) {
+    FrequencyPolicy policy(capacity, true, 0);
+    return simulate("MFU", policy, pages, out, csv, trace, cost);
+}
+
+// SIMD kernels for the Aging counters: shift every counter right by one,
+// find the smallest counter, and find the earliest loaded slot holding it.
+// AVX2 or SSE4.1 is used when the compiler targets it (e.g. -march=native),
+// otherwise the scalar loops do all the work.
+#if defined(__AVX2__)
+#define AGING_SIMD 1
+typedef __m256i simd_t;
+inline simd_t simdLoad(const void* p) { return _mm256_loadu_si256((const simd_t*)p); }
+inline void simdStore(void* p, simd_t v) { _mm256_storeu_si256((simd_t*)p, v); }
+inline simd_t simdShr1(simd_t v, uint8_t) { return _mm256_and_si256(_mm256_srli_epi16(v, 1), _mm256_set1_epi8(0x7F)); }
+inline simd_t simdShr1(simd_t v, uint16_t) { return _mm256_srli_epi16(v, 1); }
+inline simd_t simdShr1(simd_t v, uint32_t) { return _mm256_srli_epi32(v, 1); }
+inline simd_t simdMin(simd_t a, simd_t b, uint8_t) { return _mm256_min_epu8(a, b); }
+inline simd_t simdMin(simd_t a, simd_t b, uint16_t) { return _mm256_min_epu16(a, b); }
+inline simd_t simdMin(simd_t a, simd_t b, uint32_t) { return _mm256_min_epu32(a, b); }
+// 32-bit lanes: counters widened to one per lane, load stamps, byte masks.
+inline simd_t simdWiden(const uint8_t* p) { return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p)); }
+inline simd_t simdWiden(const uint16_t* p) { return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p)); }
+inline simd_t simdWiden(const uint32_t* p) { return simdLoad(p); }
+inline simd_t simdSplat(uint32_t v) { return _mm256_set1_epi32((int)v); }
+inline simd_t simdEq(simd_t a, simd_t b) { return _mm256_cmpeq_epi32(a, b); }
+inline simd_t simdSelect(simd_t mask, simd_t a, simd_t b) { return _mm256_blendv_epi8(b, a, mask); }
+inline uint32_t simdByteMask(simd_t v) { return _mm256_movemask_epi8(v); }
+#elif defined(__SSE4_1__)
+#define AGING_SIMD 1
+typedef __m128i simd_t;
+inline simd_t simdLoad(const void* p) { return _mm_loadu_si128((const simd_t*)p); }
+inline void simdStore(void* p, simd_t v) { _mm_storeu_si128((simd_t*)p, v); }
+inline simd_t simdShr1(simd_t v, uint8_t) { return _mm_and_si128(_mm_srli_epi16(v, 1), _mm_set1_epi8(0x7F)); }
+inline simd_t simdShr1(simd_t v, uint16_t) { return _mm_srli_epi16(v, 1); }
+inline simd_t simdShr1(simd_t v, uint32_t) { return _mm_srli_epi32(v, 1); }
+inline simd_t simdMin(simd_t a, simd_t b, uint8_t) { return _mm_min_epu8(a, b); }
+inline simd_t simdMin(simd_t a, simd_t b, uint16_t) { return _mm_min_epu16(a, b); }
+inline simd_t simdMin(simd_t a, simd_t b, uint32_t) { return _mm_min_epu32(a, b); }
+inline simd_t simdWiden(const uint8_t* p) {
+    int32_t four;
+    memcpy(&four, p, sizeof(four));
+    return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(four));
+}
+inline simd_t simdWiden(const uint16_t* p) { return _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)p)); }
+inline simd_t simdWiden(const uint32_t* p) { return simdLoad(p); }
+inline simd_t simdSplat(uint32_t v) { return _mm_set1_epi32((int)v); }
+inline simd_t simdEq(simd_t a, simd_t b) { return _mm_cmpeq_epi32(a, b); }
+inline simd_t simdSelect(simd_t mask, simd_t a, simd_t b) { return _mm_blendv_epi8(b, a, mask); }
+inline uint32_t simdByteMask(simd_t v) { return _mm_movemask_epi8(v); }
+#endif
+
+template <class T>
+void ageCounters(T* c, size_t n) {
+    size_t i = 0;
+#ifdef AGING_SIMD
+    const size_t lanes = sizeof(simd_t) / sizeof(T);
+    for (; i + lanes <= n; i += lanes) simdStore(c + i, simdShr1(simdLoad(c + i), T()));
+#endif
+    for (; i < n; ++i) c[i] >>= 1;
+}
+
+template <class T>
+T minCounter(const T* c, size_t n) {
+    T best = numeric_limits<T>::max();
+    size_t i = 0;
+#ifdef AGING_SIMD
+    const size_t lanes = sizeof(simd_t) / sizeof(T);
+    if (n >= lanes) {
+        simd_t acc = simdLoad(c);
+        for (i = lanes; i + lanes <= n; i += lanes) acc = simdMin(acc, simdLoad(c + i), T());
+        T lane[lanes];
+        simdStore(lane, acc);
+        for (T v : lane) best = min(best, v);
+    }
+#endif
+    for (; i < n; ++i) best = min(best, c[i]);
+    return best;
+}
+
+// Slot of the earliest loaded counter equal to least, given distinct load
+// stamps. One pass keeps the smallest stamp among matching lanes (the others
+// are masked to UINT32_MAX), a second finds the lane holding that stamp; no
+// lane is looked at one by one.
+template <class T>
+size_t oldestWithCounter(const T* c, const uint32_t* stamp, size_t n, T least) {
+    uint32_t oldest = UINT32_MAX;
+    size_t i = 0;
+#ifdef AGING_SIMD
+    const size_t lanes = sizeof(simd_t) / sizeof(uint32_t);
+    if (n >= lanes) {
+        simd_t target = simdSplat(uint32_t(least)), none = simdSplat(UINT32_MAX), acc = none;
+        for (; i + lanes <= n; i += lanes) {
+            simd_t match = simdEq(simdWiden(c + i), target);
+            acc = simdMin(acc, simdSelect(match, simdLoad(stamp + i), none), uint32_t());
+        }
+        uint32_t lane[lanes];
+        simdStore(lane, acc);
+        for (uint32_t v : lane) oldest = min(oldest, v);
+    }
+#endif
+    for (; i < n; ++i) {
+        if (c[i] == least) oldest = min(oldest, stamp[i]);
+    }
+
+    size_t j = 0;
+#ifdef AGING_SIMD
+    simd_t wanted = simdSplat(oldest);
+    for (; j + lanes <= n; j += lanes) {
+        uint32_t mask = simdByteMask(simdEq(simdLoad(stamp + j), wanted));
+        if (mask != 0) {
+#if defined(__GNUC__)
+            return j + __builtin_ctz(mask) / 4;
+#else
+            int byte = 0;
+            while (!((mask >> byte) & 1)) byte++;
+            return j + byte / 4;
+#endif
+        }
+    }
+#endif
+    for (; j < n; ++j) {
+        if (stamp[j] == oldest) return j;
+    }
+    return n;
+}
+
+// Aging over structure-of-arrays frames: page ids, counters and load order
+// live in parallel arrays indexed by slot. Counters shift once per clock tick
+// (every `tick` references); a reference sets the counter's top bit. The
+// victim is the smallest counter, the earliest loaded page among ties. Load
+// order is a 32-bit stamp per slot so the tie-break runs in SIMD lanes next
+// to the counters; stamps are renumbered by rank before they run out.
+template <class Counter>
+class AgingPolicy {
+public:
+    AgingPolicy(int capacity, int tick) : mem(capacity), counters(capacity, 0), loadedAt(capacity, 0), tick(tick), refs(0), loads(0), used(0) {}
+
+    bool access(int page) {
+        if (refs++ % tick == 0) ageCounters(counters.data(), used);
+
+        int slot = mem.slotOf(page);
+        if (slot >= 0) {
+            counters[slot] |= TOP;
+            return true;
+        }
+        if (!mem.full()) {
+            slot = mem.load(page);
+            used++;
+        } else {
+            int capacity = mem.capacity();
+            COUNT(comparisons, 2 * capacity);
+            Counter least = minCounter(counters.data(), capacity);
+            slot = oldestWithCounter(counters.data(), loadedAt.data(), capacity, least);
+            mem.replace(slot, page);
+        }
+        counters[slot] = TOP;
+        if (loads == UINT32_MAX) renumberStamps();
+        loadedAt[slot] = loads++;
+        return false;
+    }
+
+    const vector<int>& frames() const { return mem.view(); }
+    FrameChange lastLoad() const { return mem.lastLoad(); }
+
+private:
+    static constexpr Counter TOP = Counter(1) << (8 * sizeof(Counter) - 1);
+
+    // Replaces the stamps of the loaded slots by their rank, keeping order.
+    void renumberStamps() {
+        vector<int> order(used);
+        for (int k = 0; k < used; ++k) order[k] = k;
+        sort(order.begin(), order.end(), [this](int a, int b) { return loadedAt[a] < loadedAt[b]; });
+        for (int k = 0; k < used; ++k) loadedAt[order[k]] = k;
+        loads = used;
+    }
+
+    ResidentFrames mem;
+    vector<Counter> counters;
+    vector<uint32_t> loadedAt;
+    int tick;
+    uint64_t refs;
+    uint32_t loads;
+    int used;
+};
+
+// Aging
+// counterBits picks 8-, 16- or 32-bit counters; tick is the number of
+// references per clock tick (1 ages on every reference).
+pair<long long, long long> aging(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost, int tick = 1, int counterBits = 8) {
+    tick = max(1, tick);
+    string name = "Aging";
+    if (tick != 1 || counterBits != 8) name += " (" + to_string(counterBits) + "-bit, tick " + to_string(tick) + ")";
+    if (counterBits == 32) {
+        AgingPolicy<uint32_t> policy(capacity, tick);
+        return simulate(name, policy, pages, out, csv, trace, cost);
+    }
+    if (counterBits == 16) {
+        AgingPolicy<uint16_t> policy(capacity, tick);
+        return simulate(name, policy, pages, out, csv, trace, cost);
+    }
+    AgingPolicy<uint8_t> policy(capacity, tick);
+    return simulate(name, policy, pages, out, csv, trace, cost);
+}
+
+// Custom Algorithm
+// Eviction rules plug into the custom policy through this interface. The
+// engine reports every reference, hit and load (with its frame slot), so a
+// rule keeps its own state up to date incrementally and can name a victim
+// without scanning memory.
+class CustomRule {
+public:
+    virtual ~CustomRule() {}
+    virtual string name() const = 0;
+    virtual void attach(int /*capacity*/) {}  // called once before the first reference
+    virtual void onReference(int /*page*/) {} // every reference, before any eviction
+    virtual void onHit(int /*page*/, int /*slot*/) {}
+    virtual void onLoad(int page, int slot) = 0;
+    virtual int evict() = 0;                  // picks a resident slot and forgets it
+};
+
+// Base for rules that look at the last windowSize references. The window is a
+// ring buffer with per-page counts; every count change is reported through
+// onWindowCount().
+class WindowedRule : public CustomRule {
+public:
+    explicit WindowedRule(int windowSize) : ring(max(1, windowSize)), head(0), filled(0), counts(max(1, windowSize)) {}
+
+    void onReference(int page) override {
+        if (filled == (int)ring.size()) {
+            int old = ring[head];
+            int c = counts.find(old) - 1;
+            if (c == 0) counts.erase(old);
+            else counts.set(old, c);
+            onWindowCount(old, c);
+        } else {
+            filled++;
+        }
+        ring[head] = page;
+        head = (head + 1) % ring.size();
+        int c = max(0, counts.find(page)) + 1;
+        counts.set(page, c);
+        onWindowCount(page, c);
+    }
+
+protected:
+    virtual void onWindowCount(int /*page*/, int /*count*/) {}
+
+    int windowCount(int page) const { return max(0, counts.find(page)); }
+
+private:
+    vector<int> ring;
+    int head, filled;
+    PageTable counts;
+};
+
+// Evicts the resident page with the fewest references in the window,
+// the earliest loaded among ties. Resident slots sit in a heap ordered by
+// (window count, load order).
+class FewestInWindowRule : public WindowedRule {
+public:
+    explicit FewestInWindowRule(int windowSize) : WindowedRule(windowSize), loads(0) {}
+    string name() const override { return "Custom (Fewest in Window)"; }
+
+    void attach(int capacity) override {
+        order = SlotHeap<Key, Fewer>(capacity);
+        slotOf = PageTable(capacity);
+        pageAt.assign(capacity, -1);
+        loadedAt.assign(capacity, 0);
+    }
+
+    void onLoad(int page, int slot) override {
+        loadedAt[slot] = loads++;
+        order.push(slot, Key{windowCount(page), loadedAt[slot]});
+        slotOf.set(page, slot);
+        pageAt[slot] = page;
+    }
+
+    int evict() override {
+        int slot = order.top();
+        order.remove(slot);
+        slotOf.erase(pageAt[slot]);
+        return slot;
+    }
+
+protected:
+    void onWindowCount(int page, int count) override {
+        int slot = slotOf.find(page);
+        if (slot >= 0) order.update(slot, Key{count, loadedAt[slot]});
+    }
+
+private:
+    struct Key {
+        int count;
+        uint64_t loadedAt;
+    };
+    struct Fewer {
+        bool operator()(const Key& a, const Key& b) const { return a.count != b.count ? a.count < b.count : a.loadedAt < b.loadedAt; }
+    };
+
+    uint64_t loads;
+    SlotHeap<Key, Fewer> order;
+    PageTable slotOf;
+    vector<int> pageAt;
+    vector<uint64_t> loadedAt;
+};
+
+// Evicts the earliest loaded odd page, or the earliest loaded page if every
+// resident page is even.
+class EvenPriorityRule : public CustomRule {
+public:
+    string name() const override { return "Custom (Even Priority)"; }
+
+    void attach(int capacity) override {
+        loadOrder = SlotList(capacity);
+        oddOrder = SlotList(capacity);
+    }
+
+    void onLoad(int page, int slot) override {
+        loadOrder.pushBack(slot);
+        if (page % 2 != 0) oddOrder.pushBack(slot);
+    }
+
+    int evict() override {
+        int slot = oddOrder.empty() ? loadOrder.front() : oddOrder.front();
+        loadOrder.remove(slot);
+        if (oddOrder.contains(slot)) oddOrder.remove(slot);
+        return slot;
+    }
+
+private:
+    SlotList loadOrder, oddOrder;
+};
+
+// Rules offered by the Custom Algorithm Designer, in menu order.
+struct CustomRuleEntry {
+    string description;
+    bool usesWindow;
+    function<unique_ptr<CustomRule>(int windowSize)> make;
+};
+
+vector<CustomRuleEntry> customRules() {
+    return {
+        {"Evict page with fewest accesses in last N steps", true,
+         [](int w) { return unique_ptr<CustomRule>(new FewestInWindowRule(w)); }},
+        {"Give priority to even-numbered pages", false,
+         [](int) { return unique_ptr<CustomRule>(new EvenPriorityRule()); }},
+    };
+}
+
+class CustomPolicy {
+public:
+    CustomPolicy(int capacity, CustomRule& rule) : mem(capacity), rule(rule) { rule.attach(capacity); }
+
+    bool access(int page) {
+        rule.onReference(page);
+        int slot = mem.slotOf(page);
+        if (slot >= 0) {
+            rule.onHit(page, slot);
+            return true;
+        }
+        if (!mem.full()) {
+            slot = mem.load(page);
+        } else {
+            slot = rule.evict();
+            mem.replace(slot, page);
+        }
+        rule.onLoad(page, slot);
+        return false;
+    }
+
+    const vector<int>& frames() const { return mem.view(); }
+    FrameChange lastLoad() const { return mem.lastLoad(); }
+
+private:
+    ResidentFrames mem;
+    CustomRule& rule;
+};
+
+pair<long long, long long> custom(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost, CustomRule& rule) {
+    CustomPolicy policy(capacity, rule);
+    return simulate(rule.name(), policy, pages, out, csv, trace, cost);
+}
+
+// ruleChoice is a 1-based index into customRules().
+pair<long long, long long> custom(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost, int ruleChoice, int windowSize) {
+    vector<CustomRuleEntry> rules = customRules();
+    if (ruleChoice < 1 || ruleChoice > (int)rules.size()) ruleChoice = rules.size();
+    unique_ptr<CustomRule> rule = rules[ruleChoice - 1].make(windowSize);
+    return custom(pages, capacity, out, csv, trace, cost, *rule);
+}
+
+// Fenwick tree of counts (StampSet keeps one per 64-bit word)
+struct Fenwick {
+    vector<int> tree;
+    Fenwick(int n) : tree(n + 1, 0) {}
+    void add(int i, int delta) {
+        for (++i; i < (int)tree.size(); i += i & -i) tree[i] += delta;
+    }
+    int prefix(int i) const { // sum of [0, i)
+        int sum = 0;
+        for (; i > 0; i -= i & -i) sum += tree[i];
+        return sum;
+    }
+};
+
+// Set of stamps kept as a bitset with a Fenwick tree over its 64-bit words,
+// so counting the stamps above a given one costs a popcount plus O(log words)
+// on a tree 64 times smaller than the stamp range; stamps near the top are
+// counted by popcounts alone.
+class StampSet {
+public:
+    // Holds stamps 0..slots-1, of which 0..filled-1 start out in the set.
+    explicit StampSet(int slots = 0, int filled = 0) : bits((slots + 63) / 64, 0), words(bits.size()), count(filled) {
+        for (int w = 0; w < (int)bits.size(); ++w) {
+            int set = min(64, max(0, filled - 64 * w));
+            bits[w] = set == 64 ? ~0ULL : (1ULL << set) - 1;
+            // Linear-time Fenwick build: each node passes its sum to its parent.
+            int node = w + 1;
+            words.tree[node] += set;
+            int parent = node + (node & -node);
+            if (parent < (int)words.tree.size()) words.tree[parent] += words.tree[node];
+        }
+    }
+
+    int capacity() const { return bits.size() * 64; }
+
+    void insert(int s) {
+        bits[s >> 6] |= 1ULL << (s & 63);
+        words.add(s >> 6, 1);
+        count++;
+    }
+
+    void erase(int s) {
+        bits[s >> 6] &= ~(1ULL << (s & 63));
+        words.add(s >> 6, -1);
+        count--;
+    }
+
+    // Stamps in the set greater than s; every stamp is below end.
+    int countAbove(int s, int end) const {
+        int w = s >> 6, last = (end - 1) >> 6;
+        int above = (s & 63) == 63 ? 0 : popcount(bits[w] >> ((s & 63) + 1));
+        if (last - w <= 2) {
+            for (int i = w + 1; i <= last; ++i) above += popcount(bits[i]);
+            return above;
+        }
+        return above + count - words.prefix(w + 1);
+    }
+
+private:
+    static int popcount(uint64_t x) {
+#if defined(__GNUC__)
+        return __builtin_popcountll(x);
+#else
+        int n = 0;
+        for (; x; x &= x - 1) n++;
+        return n;
+#endif
+    }
+
+    vector<uint64_t> bits;
+    Fenwick words;
+    int count;
+};
+
+// LRU stack distances over small integer ids: the distance of a touch is the
+// number of distinct ids touched since the id's previous touch. Each id keeps
+// the stamp of its last touch in a StampSet; stamps are renumbered when the
+// set fills, so memory follows the number of live ids, not the number of
+// touches.
+class ReuseStack {
+public:
+    ReuseStack() : marks(1024), nextStamp(0), live(0) {}
+
+    // Distance of this touch, or -1 if id is new (or was forgotten).
+    int touch(int id) {
+        if (id >= (int)stamp.size()) stamp.resize(id + 1, -1);
+        if (nextStamp == marks.capacity()) renumber();
+        int distance = -1;
+        if (stamp[id] >= 0) {
+            distance = marks.countAbove(stamp[id], nextStamp);
+            marks.erase(stamp[id]);
+        } else {
+            live++;
+        }
+        stamp[id] = nextStamp;
+        marks.insert(nextStamp++);
+        return distance;
+    }
+
+    // Drops id from the stack; it no longer counts towards other distances.
+    void forget(int id) {
+        if (id >= (int)stamp.size() || stamp[id] < 0) return;
+        marks.erase(stamp[id]);
+        stamp[id] = -1;
+        live--;
+    }
+
+private:
+    // Renumbers the live stamps to 0..live-1 in the same order, in a set with
+    // room for three times as many again.
+    void renumber() {
+        vector<int> byStamp(nextStamp, -1);
+        for (int id = 0; id < (int)stamp.size(); ++id) {
+            if (stamp[id] >= 0) byStamp[stamp[id]] = id;
+        }
+        nextStamp = 0;
+        for (int id : byStamp) {
+            if (id >= 0) stamp[id] = nextStamp++;
+        }
+        marks = StampSet(max(1024, 4 * live), nextStamp);
+    }
+
+    vector<int> stamp; // by id, -1 when not on the stack
+    StampSet marks;
+    int nextStamp, live;
+};
+
+// Miss-Ratio Curve: hits for every frame count 1..maxFrames in one pass.
+// LRU uses Mattson stack distances (distinct pages since the previous use,
+// counted by a ReuseStack, whose memory follows the number of distinct
+// pages). OPT uses Mattson's priority stack ordered by next use; the stack
+// is cut off at maxFrames since deeper levels never affect smaller
+// memories. Its next uses come from a NextUseTable, packed for a packed
+// trace. Results match lru()/optimal() run per capacity. Unlike the LRU
+// half (O(log n) per reference), the OPT update walks the stack down to the
+// page's depth, and the pages above it typically all shift by one, so OPT
+// costs O(n * maxFrames) in the worst case. A page with no next use stops
+// the walk early, which keeps scans cheap.
+void missRatioCurve(PageView pages, int maxFrames, const string& path) {
+    size_t n = pages.size();
+    vector<long long> lruHist(maxFrames + 2, 0), optHist(maxFrames + 2, 0);
+
+    // LRU stack distances
+    ReuseStack recency;
+    PageTable dense;
+    int distinct = 0;
+    forEachPage(pages, [&](size_t, int page) {
+        int id = dense.find(page);
+        if (id < 0) dense.set(page, id = distinct++);
+        int distance = recency.touch(id); // other pages since the last use
+        if (distance >= 0) lruHist[min(distance + 1, maxFrames + 1)]++;
+    });
+
+    // OPT stack distances
+    NextUseTable table(pages);
+    NextUseCursor nextUse(table);
+    vector<int> stack;
+    vector<int64_t> stackNext;
+    PageTable depthOf(maxFrames); // page -> depth in the stack
+    forEachPage(pages, [&](size_t, int page) {
+        int depth = depthOf.find(page);
+        if (depth >= 0) optHist[depth + 1]++;
+        int limit = (depth >= 0) ? depth : stack.size();
+
+        int carried = page;
+        int64_t carriedNext = nextUse.next();
+        int j = 0;
+        for (; j < limit; ++j) {
+            // A page that is never used again loses every comparison below,
+            // so it can drop straight to the bottom of the affected range.
+            if (j > 0 && carriedNext == NEVER_USED) break;
+            if (j == 0 || carriedNext < stackNext[j]) {
+                swap(carried, stack[j]);
+                swap(carriedNext, stackNext[j]);
+                depthOf.set(stack[j], j);
+            }
+        }
+        if (depth >= 0) {
+            stack[depth] = carried;
+            stackNext[depth] = carriedNext;
+            depthOf.set(carried, depth);
+        } else if ((int)stack.size() < maxFrames) {
+            stack.push_back(carried);
+            stackNext.push_back(carriedNext);
+            depthOf.set(carried, stack.size() - 1);
+        } else {
+            depthOf.erase(carried);
+        }
+    });
+
+    ofstream mrc(path);
+    mrc << "Frames,LRUHits,LRUHitRate,OPTHits,OPTHitRate\n";
+    long long lruHits = 0, optHits = 0;
+    for (int c = 1; c <= maxFrames; ++c) {
+        lruHits += lruHist[c];
+        optHits += optHist[c];
+        mrc << c << "," << lruHits << "," << fixed << setprecision(2) << 100.0 * lruHits / n
+            << "," << optHits << "," << 100.0 * optHits / n << "\n";
+    }
+    cout << "\nMiss-ratio curve for 1.." << maxFrames << " frames written to " << path << "\n";
+    cout << "At " << maxFrames << " frames: LRU hit rate " << fixed << setprecision(2) << 100.0 * lruHits / n
+         << "%, OPT hit rate " << 100.0 * optHits / n << "%\n";
+}
+
+// Memory Access Patterns Detector
+// One-pass analyzer that can sit on a stream. It is fed every reference with
+// the page's dense id, and keeps:
+//  - LRU reuse (stack) distances: distinct pages since the previous use, from
+//    a ReuseStack over dense ids, so memory follows the number of distinct
+//    pages rather than the length of the stream.
+//    Distances go into log2 bins: 0, 1, 2-3, 4-7, ...
+//  - the working-set size of every interval of `interval` references, and its
+//    Jaccard similarity with the previous interval. A similarity below
+//    PHASE_SIMILARITY times the running average (an EWMA) marks a phase
+//    change, so steadily random or streaming traces do not flag every
+//    interval.
+//  - runs of equal non-zero strides (page - previous page), sequential
+//    (+/-1) steps, and the most frequent strides (Misra-Gries, TOP_STRIDES
+//    counters).
+class AccessAnalyzer {
+public:
+    static constexpr int BINS = 33;
+    static constexpr int TOP_STRIDES = 8;
+    static constexpr double PHASE_SIMILARITY = 0.5;
+
+    struct Interval {
+        long long end;     // references seen when the interval closed
+        int workingSet;    // distinct pages referenced in the interval
+        double similarity; // Jaccard similarity with the previous interval
+        bool phaseChange;
+    };
+
+    explicit AccessAnalyzer(long long interval = 10000)
+        : interval(max(1LL, interval)), untilInterval(this->interval), references(0), cold(0), reuseHist(BINS, 0),
+          currentInterval(0), intervalDistinct(0), intervalOverlap(0), previousDistinct(0), typicalSimilarity(-1.0),
+          previousPage(0), stride(0), runLength(0), sequential(0), runs(0), runRefs(0), longestRun(0),
+          strideValue(TOP_STRIDES, 0), strideCount(TOP_STRIDES, 0) {}
+
+    // id is the page's dense id (ids are handed out in order from 0).
+    void add(int page, int id) {
+        if (id == (int)lastInterval.size()) lastInterval.push_back(INT_MIN);
+
+        // Reuse distance
+        int distance = stack.touch(id);
+        if (distance < 0) cold++;
+        else reuseHist[bin(distance)]++;
+
+        // Working set and phases
+        if (lastInterval[id] != currentInterval) {
+            if (lastInterval[id] == currentInterval - 1) intervalOverlap++;
+            lastInterval[id] = currentInterval;
+            intervalDistinct++;
+        }
+
+        // Strides
+        if (references > 0) {
+            long long step = (long long)page - previousPage;
+            if (step == 1 || step == -1) sequential++;
+            if (step != 0 && step == stride) {
+                runLength++;
+            } else {
+                closeRun();
+                stride = step;
+                runLength = step != 0 ? 2 : 0;
+            }
+            if (step != 0) countStride(step);
+        }
+        previousPage = page;
+
+        references++;
+        if (--untilInterval == 0) closeInterval();
+    }
+
+    // Closes the partial interval and stride run at the end of the input.
+    void finish() {
+        if (references % interval != 0) closeInterval();
+        closeRun();
+        runLength = 0;
+    }
+
+    long long totalReferences() const { return references; }
+    int distinctPages() const { return lastInterval.size(); }
+    const vector<Interval>& intervals() const { return history; }
+
+    // Smallest frame count at which LRU would hit on `fraction` of all
+    // reuses (rounded up to the bin bound, capped at the distinct pages), or 0
+    // if nothing was reused.
+    long long framesFor(double fraction) const {
+        long long reuses = references - cold, sum = 0;
+        if (reuses == 0) return 0;
+        int b = 0;
+        for (; b < BINS - 1; ++b) {
+            sum += reuseHist[b];
+            if (sum >= fraction * reuses) break;
+        }
+        return min<long long>(binHigh(b) + 1, distinctPages());
+    }
+
+    int phaseChanges() const {
+        int count = 0;
+        for (const Interval& i : history) count += i.phaseChange;
+        return count;
+    }
+
+    string recommendation() const {
+        double n = max(1LL, references);
+        double coldRatio = cold / n;
+        double seqRatio = references > 1 ? sequential / (n - 1) : 0.0;
+        double runRatio = (runRefs + (runLength >= 3 ? runLength : 0)) / n;
+        int phases = phaseChanges();
+        long long median = framesFor(0.5);
+
+        if ((seqRatio > 0.7 || runRatio > 0.7) && coldRatio > 0.5) {
+            return "Sequential (FIFO or LRU recommended)";
+        } else if (seqRatio > 0.7 || runRatio > 0.7) {
+            return "Looping (LRU/FIFO need " + to_string(framesFor(0.9)) + " frames; below that MFU or CLOCK-Pro)";
+        } else if (coldRatio > 0.5) {
+            return "Streaming, little reuse (FIFO recommended; extra frames barely help)";
+        } else if (phases > 0 && phases * 10 >= (int)history.size()) {
+            return "Phased (Aging or CLOCK-Pro recommended)";
+        } else if (median > 0 && median * 16 <= distinctPages()) {
+            return "Locality-based (LRU or CLOCK-Pro recommended)";
+        } else {
+            return "Random (Aging or Second Chance recommended)";
+        }
+    }
+
+    void printReport(ostream& out) const {
+        out << "References       : " << references << " (" << distinctPages() << " distinct pages)\n";
+        out << "Reuse distance   : LRU frames for 50/90/99% of reuses: " << framesFor(0.5) << " / "
+            << framesFor(0.9) << " / " << framesFor(0.99) << "\n";
+        if (!history.empty()) {
+            long long sum = 0;
+            int peak = 0;
+            for (const Interval& i : history) {
+                sum += i.workingSet;
+                peak = max(peak, i.workingSet);
+            }
+            out << "Working set      : mean " << sum / (long long)history.size() << ", peak " << peak
+                << " pages per " << interval << " references\n";
+            out << "Phase changes    : " << phaseChanges();
+            int shown = 0;
+            for (const Interval& i : history) {
+                if (!i.phaseChange) continue;
+                if (shown++ == 5) {
+                    out << " ...";
+                    break;
+                }
+                out << (shown == 1 ? " at reference " : ", ") << i.end - interval;
+            }
+            out << "\n";
+        }
+        double n = max(1LL, references);
+        out << "Strides          : " << fixed << setprecision(2) << 100.0 * sequential / max(1.0, n - 1)
+            << "% sequential, " << runs + (runLength >= 3) << " strided runs covering "
+            << 100.0 * (runRefs + (runLength >= 3 ? runLength : 0)) / n << "% of references, longest "
+            << max(longestRun, runLength) << "\n";
+        out << "Suggested frames : " << framesFor(0.9) << " (LRU keeps 90% of reuses)\n";
+    }
+
+    // Writes the reuse-distance histogram, the per-interval working set and
+    // the stride statistics as CSV.
+    bool exportCsv(const string& reusePath, const string& workingSetPath, const string& stridePath) const {
+        ofstream reuse(reusePath), ws(workingSetPath), strides(stridePath);
+        long long reuses = 0;
+        reuse << "DistanceLow,DistanceHigh,Count,CumulativeHitRate\n";
+        for (int b = 0; b < BINS; ++b) {
+            reuses += reuseHist[b];
+            if (reuseHist[b] == 0) continue;
+            reuse << binLow(b) << "," << binHigh(b) << "," << reuseHist[b] << "," << fixed << setprecision(4)
+                  << (double)reuses / max(1LL, references) << "\n";
+        }
+        reuse << "cold,cold," << cold << ",\n";
+
+        ws << "Reference,WorkingSet,Similarity,PhaseChange\n";
+        for (const Interval& i : history) {
+            ws << i.end << "," << i.workingSet << "," << fixed << setprecision(4) << i.similarity << "," << i.phaseChange << "\n";
+        }
+
+        strides << "Stride,Count\n";
+        vector<pair<long long, long long>> top;
+        for (int k = 0; k < TOP_STRIDES; ++k) {
+            if (strideCount[k] > 0) top.push_back({strideCount[k], strideValue[k]});
+        }
+        sort(top.rbegin(), top.rend());
+        for (const auto& t : top) strides << t.second << "," << t.first << "\n";
+        return reuse && ws && strides;
+    }
+
+private:
+    static int bin(long long distance) {
+        int b = 0;
+        while (distance > 0 && b < BINS - 1) {
+            distance >>= 1;
+            b++;
+        }
+        return b;
+    }
+    static long long binLow(int b) { return b == 0 ? 0 : 1LL << (b - 1); }
+    static long long binHigh(int b) { return b == 0 ? 0 : (1LL << b) - 1; }
+
+    void closeInterval() {
+        int unionSize = intervalDistinct + previousDistinct - intervalOverlap;
+        double similarity = unionSize > 0 ? (double)intervalOverlap / unionSize : 1.0;
+        bool change = typicalSimilarity >= 0 && similarity < PHASE_SIMILARITY * typicalSimilarity;
+        if (!history.empty()) typicalSimilarity = typicalSimilarity < 0 ? similarity : 0.75 * typicalSimilarity + 0.25 * similarity;
+        history.push_back({references, intervalDistinct, similarity, change});
+        previousDistinct = intervalDistinct;
+        intervalDistinct = intervalOverlap = 0;
+        currentInterval++;
+        untilInterval = interval;
+    }
+
+    // A run counts once it has at least two equal strides (three pages).
+    void closeRun() {
+        if (runLength >= 3) {
+            runs++;
+            runRefs += runLength;
+            longestRun = max(longestRun, runLength);
+        }
+    }
+
+    void countStride(long long step) {
+        for (int k = 0; k < TOP_STRIDES; ++k) {
+            if (strideCount[k] > 0 && strideValue[k] == step) {
+                strideCount[k]++;
+                return;
+            }
+        }
+        for (int k = 0; k < TOP_STRIDES; ++k) {
+            if (strideCount[k] == 0) {
+                strideValue[k] = step;
+                strideCount[k] = 1;
+                return;
+            }
+        }
+        for (int k = 0; k < TOP_STRIDES; ++k) strideCount[k]--;
+    }
+
+    long long interval, untilInterval, references, cold;
+    vector<long long> reuseHist;
+    ReuseStack stack;
+    vector<int> lastInterval; // dense id -> last interval it was seen in
+    int currentInterval, intervalDistinct, intervalOverlap, previousDistinct;
+    double typicalSimilarity; // EWMA of past similarities, -1 until known
+    vector<Interval> history;
+    int previousPage;
+    long long stride, runLength, sequential, runs, runRefs, longestRun;
+    vector<long long> strideValue, strideCount;
+};
+
+// Whole-trace facts gathered in one forward pass, shared by every consumer:
+// page ids are remapped to dense ids in first-seen order so per-page state
+// lives in flat arrays, Optimal's next uses are filled in as each page
+// recurs, and an AccessAnalyzer, if given, sees every reference on the way.
+// A packed trace gets its next uses from a separate backward pass instead,
+// since filling them in forward needs the whole table unpacked.
+struct TraceSummary {
+    NextUseTable nextUse; // empty unless requested
+};
+
+TraceSummary summarizeTrace(PageView pages, bool withNextUse, AccessAnalyzer* analyzer = nullptr) {
+    TraceSummary summary;
+    bool fillNextUse = withNextUse && !pages.packed;
+    if (fillNextUse) summary.nextUse.distances.assign(pages.size(), 0);
+    PageTable dense;
+    int distinct = 0;
+    vector<int64_t> lastSeen; // per dense id, only when filling next uses
+    forEachPage(pages, [&](size_t i, int page) {
+        int id = dense.find(page);
+        if (id < 0) {
+            id = distinct++;
+            dense.set(page, id);
+            if (fillNextUse) lastSeen.push_back(-1);
+        }
+        if (fillNextUse) {
+            int64_t last = lastSeen[id];
+            if (last >= 0) summary.nextUse.distances[last] = summary.nextUse.encode(last, i);
+            lastSeen[id] = i;
+        }
+        if (analyzer) analyzer->add(page, id);
+    });
+    if (withNextUse && pages.packed) summary.nextUse = NextUseTable(pages);
+    if (analyzer) analyzer->finish();
+    return summary;
+}
+
+const char* const PATTERN_FILES[3] = {"reuse_distance.csv", "working_set.csv", "strides.csv"};
+
+// Prints the analysis with its recommendation and writes the CSV exports.
+void reportPattern(const AccessAnalyzer& analyzer, ostream& out) {
+    out << "\n=== Memory Access Pattern Analysis ===\n";
+    analyzer.printReport(out);
+    out << "Detected Pattern : " << analyzer.recommendation() << "\n";
+    if (analyzer.exportCsv(PATTERN_FILES[0], PATTERN_FILES[1], PATTERN_FILES[2])) {
+        out << "Written to " << PATTERN_FILES[0] << ", " << PATTERN_FILES[1] << " and " << PATTERN_FILES[2] << "\n";
+    }
+    out << string(40, '=') << "\n";
+}
+
+// Spatial hash for page sampling (splitmix64 finalizer): a page is sampled at
+// rate R when the top 32 bits fall below R * 2^32, so every reference to a
+// sampled page is seen and none of the others.
+uint64_t spatialHash(int page) {
+    uint64_t z = uint64_t(uint32_t(page)) + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Approximate Miss-Ratio Curve (SHARDS; Waldspurger et al., FAST 2015)
+// LRU reuse distances are tracked only for pages whose spatial hash falls
+// below a threshold, i.e. a fixed fraction R of the page space. Each sampled
+// distance d stands for a true distance of d / R, and each sampled reference
+// for 1 / R references. With a sample budget the threshold starts at 1 and
+// drops whenever more than `budget` pages are sampled, evicting the pages
+// with the largest hashes, so memory stays constant however many distinct
+// pages the trace has. The shortfall between the references seen and the
+// weight of the sampled ones is credited as hits at the smallest distance
+// (SHARDS_adj). The error estimate splits the sample into GROUPS
+// independent sub-samples by another part of the hash; the standard error
+// of each point is the spread of their curves over sqrt(GROUPS).
+class ShardsMrc {
+public:
+    static constexpr int GROUPS = 8;
+
+    struct Point {
+        long long frames;
+        double hitRate, stdError; // in percent
+    };
+
+    // maxFrames is covered by `points` evenly spaced frame counts. rate is the
+    // initial sampling rate (0..1]; budget > 0 caps the sampled pages.
+    ShardsMrc(long long maxFrames, double rate, int budget, int points = 1000)
+        : points(max(1LL, min<long long>(points, maxFrames))), width((maxFrames + this->points - 1) / this->points),
+          threshold(min(1.0, max(rate, 1e-9)) * HASH_RANGE), budget(budget), references(0), sampledRefs(0),
+          sampledWeight(0), hist(this->points, 0.0), groupWeight(GROUPS, 0.0),
+          groupHist(GROUPS, vector<double>(this->points, 0.0)), byHash(budget > 0 ? budget + 1 : 0) {}
+
+    void add(int page) {
+        references++;
+        uint64_t h = spatialHash(page);
+        uint64_t value = h >> 32;
+        if (value >= threshold) return;
+
+        int slot = table.find(page);
+        if (slot < 0) {
+            if (freeSlots.empty()) {
+                slot = pageOf.size();
+                pageOf.push_back(page);
+                groupOf.push_back(0);
+            } else {
+                slot = freeSlots.back();
+                freeSlots.pop_back();
+                pageOf[slot] = page;
+            }
+            groupOf[slot] = h & (GROUPS - 1);
+            table.set(page, slot);
+            if (budget > 0) byHash.push(slot, value);
+        }
+
+        double weight = HASH_RANGE / threshold;
+        int group = groupOf[slot];
+        sampledRefs++;
+        sampledWeight += weight;
+        groupWeight[group] += weight * GROUPS;
+        int distance = stack.touch(slot);
+        if (distance >= 0) count(hist, distance * weight, weight);
+        distance = groupStacks[group].touch(slot);
+        if (distance >= 0) count(groupHist[group], distance * weight * GROUPS, weight * GROUPS);
+
+        if (budget > 0 && (int)table.size() > budget) shrink();
+    }
+
+    double rate() const { return threshold / HASH_RANGE; }
+    long long totalReferences() const { return references; }
+    long long sampledReferences() const { return sampledRefs; }
+    size_t sampledPages() const { return table.size(); }
+
+    vector<Point> curve() const {
+        vector<Point> result;
+        double cum = 0;
+        vector<double> groupCum(GROUPS, 0.0);
+        for (long long i = 0; i < points; ++i) {
+            cum += hist[i];
+            double mean = 0, var = 0;
+            vector<double> estimates(GROUPS);
+            for (int g = 0; g < GROUPS; ++g) {
+                groupCum[g] += groupHist[g][i];
+                estimates[g] = hitRate(groupCum[g], groupWeight[g]);
+                mean += estimates[g] / GROUPS;
+            }
+            for (double e : estimates) var += (e - mean) * (e - mean) / (GROUPS - 1);
+            result.push_back({(i + 1) * width, hitRate(cum, sampledWeight), sqrt(var / GROUPS)});
+        }
+        return result;
+    }
+
+    void write(const string& path, ostream& out) const {
+        vector<Point> c = curve();
+        ofstream mrc(path);
+        mrc << "Frames,EstLRUHitRate,StdError\n";
+        for (const Point& p : c) mrc << p.frames << "," << fixed << setprecision(2) << p.hitRate << "," << p.stdError << "\n";
+
+        out << "\nApproximate LRU miss-ratio curve written to " << path << "\n";
+        out << "Sampled " << sampledRefs << " of " << references << " references, " << sampledPages()
+            << " pages in the sample, final rate " << setprecision(6) << rate() << "\n";
+        size_t step = max<size_t>(1, c.size() / 10);
+        for (size_t i = step - 1; i < c.size(); i += step) {
+            out << setw(12) << right << c[i].frames << left << " frames: " << fixed << setprecision(2) << c[i].hitRate
+                << "% +/- " << c[i].stdError << "%\n";
+        }
+    }
+
+private:
+    static constexpr double HASH_RANGE = 4294967296.0; // 2^32
+
+
+    void count(vector<double>& h, double scaledDistance, double weight) {
+        double bucket = scaledDistance / width;
+        if (bucket < points) h[(long long)bucket] += weight;
+    }
+
+    // Hit rate with the SHARDS_adj correction: misses are the sampled weight
+    // that was not a hit, over every reference seen.
+    double hitRate(double hits, double weight) const {
+        if (references == 0) return 0;
+        double missRate = (weight - hits) / references;
+        return 100.0 * min(1.0, max(0.0, 1.0 - missRate));
+    }
+
+    // Lowers the threshold to the largest sampled hash and drops every page
+    // at or above it.
+    void shrink() {
+        threshold = byHash.topKey();
+        while (!byHash.empty() && byHash.topKey() >= threshold) {
+            int slot = byHash.top();
+            byHash.remove(slot);
+            stack.forget(slot);
+            groupStacks[groupOf[slot]].forget(slot);
+            table.erase(pageOf[slot]);
+            freeSlots.push_back(slot);
+        }
+    }
+
+    struct LargerFirst {
+        bool operator()(uint64_t a, uint64_t b) const { return a > b; }
+    };
+
+    long long points, width;
+    double threshold;
+    int budget;
+    long long references, sampledRefs;
+    double sampledWeight;
+    vector<double> hist, groupWeight;
+    vector<vector<double>> groupHist;
+    PageTable table; // sampled page -> slot
+    vector<int> pageOf, groupOf, freeSlots;
+    ReuseStack stack, groupStacks[GROUPS];
+    SlotHeap<uint64_t, LargerFirst> byHash;
+};
+
+// Address-trace ingestion
+// Turns a Valgrind lackey-style trace (" L 04222cac,4" lines: I, L, S or M,
+// a hex address and a size) into a binary trace in one pass. Addresses are
+// shifted down to 64-bit page numbers, which are remapped to dense ids in
+// first-seen order; the remap table goes into the trace's trailer so the
+// original page addresses can be recovered. An access that straddles a page
+// boundary references every page it touches, and M (modify) counts once.
+// S and M references are recorded as writes in the trace's write section.
+// Instruction fetches are skipped unless withInstructions is set.
+struct IngestStats {
+    uint64_t lines = 0, references = 0, skipped = 0, writes = 0;
+    size_t pages = 0;
+};
+
+// "4K", "2M", "1G", "4096", ... -> log2 of the page size, or -1 unless it is
+// a power of two.
+int parsePageShift(const string& text) {
+    char* end;
+    unsigned long long size = strtoull(text.c_str(), &end, 10);
+    switch (toupper(*end)) {
+        case 'K': size <<= 10; end++; break;
+        case 'M': size <<= 20; end++; break;
+        case 'G': size <<= 30; end++; break;
+    }
+    if (*end != '\0' || size == 0 || (size & (size - 1)) != 0) return -1;
+    int shift = 0;
+    while ((1ULL << shift) < size) shift++;
+    return shift;
+}
+
+bool ingestAddressTrace(const string& inPath, const string& outPath, int pageShift, bool withInstructions, IngestStats& stats) {
+    FILE* in = (inPath == "-") ? stdin : fopen(inPath.c_str(), "rb");
+    BinaryTraceWriter writer;
+    if (!in || !writer.open(outPath, 0)) {
+        if (in && in != stdin) fclose(in);
+        return false;
+    }
+
+    BasicPageTable<uint64_t> dense(1 << 16);
+    vector<uint64_t> pageNumbers;
+    vector<int> ids;
+    vector<uint8_t> writeBits;
+    ids.reserve(1 << 16);
+    bool ok = true;
+
+    auto parseLine = [&](const char* p, const char* end) {
+        stats.lines++;
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        if (p == end) return;
+        char kind = *p++;
+        if (kind != 'I' && kind != 'L' && kind != 'S' && kind != 'M') {
+            stats.skipped++; // tool banners, blank or foreign lines
+            return;
+        }
+        if (kind == 'I' && !withInstructions) return;
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        uint64_t address = 0, size = 0;
+        const char* digits = p;
+        for (; p < end && isxdigit((unsigned char)*p); ++p) {
+            address = address * 16 + (isdigit((unsigned char)*p) ? *p - '0' : (tolower(*p) - 'a' + 10));
+        }
+        if (p == digits) {
+            stats.skipped++;
+            return;
+        }
+        if (p < end && *p == ',') {
+            for (++p; p < end && isdigit((unsigned char)*p); ++p) size = size * 10 + (*p - '0');
+        }
+        uint64_t first = address >> pageShift, last = (address + max<uint64_t>(size, 1) - 1) >> pageShift;
+        for (uint64_t page = first; page <= last; ++page) {
+            int id = dense.find(page);
+            if (id < 0) {
+                if (pageNumbers.size() == (size_t)INT_MAX) {
+                    ok = false;
+                    return;
+                }
+                id = pageNumbers.size();
+                dense.set(page, id);
+                pageNumbers.push_back(page);
+            }
+            ids.push_back(id);
+            if ((stats.references & 7) == 0) writeBits.push_back(0);
+            if (kind == 'S' || kind == 'M') {
+                writeBits.back() |= 1 << (stats.references & 7);
+                stats.writes++;
+            }
+            stats.references++;
+        }
+        if (ids.size() >= (1 << 16)) {
+            ok = ok && writer.write(ids.data(), ids.size());
+            ids.clear();
+        }
+    };
+
+    // Whole lines are parsed out of large reads; a line cut off at the end
+    // of a read moves to the front of the buffer for the next one.
+    vector<char> buf(1 << 20);
+    size_t carry = 0, got;
+    while (ok && (got = fread(buf.data() + carry, 1, buf.size() - carry, in)) > 0) {
+        const char* p = buf.data();
+        const char* end = p + carry + got;
+        for (const char* nl; ok && (nl = (const char*)memchr(p, '\n', end - p)) != nullptr; p = nl + 1) parseLine(p, nl);
+        carry = end - p;
+        if (carry == buf.size()) buf.resize(buf.size() * 2); // a very long line
+        memmove(buf.data(), p, carry);
+    }
+    if (ok && carry > 0) parseLine(buf.data(), buf.data() + carry);
+    ok = ok && !ferror(in);
+    if (in != stdin) fclose(in);
+
+    ok = ok && writer.write(ids.data(), ids.size()) && writer.setCount(stats.references) && writer.writeRemap(pageShift, pageNumbers);
+    if (stats.writes > 0) ok = ok && writer.beginWrites(stats.references) && writer.writeBits(writeBits.data(), writeBits.size());
+    stats.pages = pageNumbers.size();
+    return ok;
+}
+
+// Writes the page address behind every reference of an ingested trace, one
+// hex address per line.
+bool recoverAddresses(const string& tracePath, const string& outPath) {
+    TraceFile trace;
+    uint32_t pageShift;
+    vector<uint64_t> pageNumbers;
+    if (!trace.open(tracePath) || !readRemap(tracePath, pageShift, pageNumbers)) return false;
+    FILE* out = fopen(outPath.c_str(), "w");
+    if (!out) return false;
+    for (int id : trace.view()) {
+        if (id < 0 || (size_t)id >= pageNumbers.size()) {
+            fclose(out);
+            return false;
+        }
+        fprintf(out, "0x%llx\n", (unsigned long long)(pageNumbers[id] << pageShift));
+    }
+    return fclose(out) == 0;
+}
+
+// Work-stealing thread pool: every worker owns a deque, runs its own tasks from
+// the back and steals from the front of the other deques once it runs dry.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(int threads) : queues(max(1, threads)) {}
+
+    // Runs every task and returns once all of them have finished.
+    void run(vector<function<void()>>& tasks) {
+        int workers = queues.size();
+        for (size_t i = 0; i < tasks.size(); ++i) queues[i % workers].tasks.push_back(&tasks[i]);
+        vector<thread> pool;
+        for (int w = 1; w < workers; ++w) pool.emplace_back([this, w] { work(w); });
+        work(0);
+        for (auto& t : pool) t.join();
+    }
+
+    // Runs every task once per round on the same workers. before(round) runs
+    // on one thread while no task is running; a round starts only once every
+    // task of the previous one has finished.
+    void runRounds(vector<function<void()>>& tasks, size_t rounds, const function<void(size_t)>& before) {
+        if (rounds == 0) return;
+        int workers = queues.size();
+        size_t round = 0, generation = 0;
+        int arrived = 0;
+        mutex barrier;
+        condition_variable released;
+        auto deal = [&] {
+            before(round);
+            for (size_t i = 0; i < tasks.size(); ++i) queues[i % workers].tasks.push_back(&tasks[i]);
+        };
+        auto worker = [&](int w) {
+            for (size_t r = 0; r < rounds; ++r) {
+                work(w);
+                unique_lock<mutex> guard(barrier);
+                if (++arrived == workers) {
+                    arrived = 0;
+                    if (++round < rounds) deal();
+                    generation++;
+                    released.notify_all();
+                } else {
+                    size_t current = generation;
+                    released.wait(guard, [&] { return generation != current; });
+                }
+            }
+        };
+        deal();
+        vector<thread> pool;
+        for (int w = 1; w < workers; ++w) pool.emplace_back(worker, w);
+        worker(0);
+        for (auto& t : pool) t.join();
+    }
+
+private:
+    struct Queue {
+        mutex lock;
+        deque<function<void()>*> tasks;
+    };
+
+    bool take(int w, function<void()>*& task) {
+        lock_guard<mutex> guard(queues[w].lock);
+        if (queues[w].tasks.empty()) return false;
+        task = queues[w].tasks.back();
+        queues[w].tasks.pop_back();
+        return true;
+    }
+
+    bool steal(int w, function<void()>*& task) {
+        for (size_t k = 1; k < queues.size(); ++k) {
+            Queue& victim = queues[(w + k) % queues.size()];
+            lock_guard<mutex> guard(victim.lock);
+            if (victim.tasks.empty()) continue;
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void work(int w) {
+        function<void()>* task;
+        while (take(w, task) || steal(w, task)) (*task)();
+    }
+
+    vector<Queue> queues;
+};
+
+// Tunables given on the command line.
+struct SimSettings {
+    int lfuDecay = 0;    // references between LFU frequency halvings, 0 = never
+    int agingTick = 1;   // references per Aging clock tick
+    int agingBits = 8;   // Aging counter width: 8, 16 or 32
+    long long adaptWindow = 100000; // references per Adaptive selection window
+    CostModel cost;      // latency model for menu runs and sweeps
+};
+
+// Online policies
+// Policies driven one reference at a time, from a stream or block by block. push()
+// returns 1 for a hit, 0 for a fault, or -1 when the outcome of an earlier
+// reference is still pending (bounded-lookahead Optimal); flush() settles
+// pending references once the input ends.
+class StreamPolicy {
+public:
+    virtual ~StreamPolicy() {}
+    virtual int push(int page) = 0;
+    virtual int flush() { return -1; }
+    virtual const vector<int>& frames() const = 0;
+    virtual FrameChange lastLoad() const = 0;
+
+    // Feeds n references, stores each outcome (1 = hit) in hit[i] and
+    // returns the number of hits. Only meaningful for policies that decide
+    // every reference immediately.
+    virtual long long pushBlock(const int* pages, size_t n, uint8_t* hit) {
+        long long hits = 0;
+        for (size_t i = 0; i < n; ++i) hits += hit[i] = push(pages[i]) == 1;
+        return hits;
+    }
+};
+
+template <class Policy>
+class OnlinePolicy : public StreamPolicy {
+public:
+    template <class... Args>
+    explicit OnlinePolicy(Args&&... args) : policy(std::forward<Args>(args)...) {}
+    int push(int page) override { return policy.access(page); }
+    const vector<int>& frames() const override { return policy.frames(); }
+    FrameChange lastLoad() const override { return policy.lastLoad(); }
+
+    long long pushBlock(const int* pages, size_t n, uint8_t* hit) override {
+        long long hits = 0;
+        for (size_t i = 0; i < n; ++i) hits += hit[i] = policy.access(pages[i]);
+        return hits;
+    }
+
+private:
+    Policy policy;
+};
+
+class OnlineCustom : public StreamPolicy {
+public:
+    OnlineCustom(int capacity, unique_ptr<CustomRule> rule) : rule(std::move(rule)), policy(capacity, *this->rule) {}
+    int push(int page) override { return policy.access(page); }
+    const vector<int>& frames() const override { return policy.frames(); }
+    FrameChange lastLoad() const override { return policy.lastLoad(); }
+
+private:
+    unique_ptr<CustomRule> rule;
+    CustomPolicy policy;
+};
+
+class OnlineLookahead : public StreamPolicy {
+public:
+    OnlineLookahead(int capacity, int lookahead) : policy(capacity, lookahead) {}
+    int push(int page) override { return policy.push(page); }
+    int flush() override { return policy.flush(); }
+    const vector<int>& frames() const override { return policy.frames(); }
+    FrameChange lastLoad() const override { return policy.lastLoad(); }
+
+private:
+    LookaheadOptimalPolicy policy;
+};
+
+// Builds a named online policy with a given number of frames.
+struct PolicyFactory {
+    string name;
+    function<StreamPolicy*(int capacity)> make;
+};
+
+// Adaptive policy selection
+// A meta-policy that picks its eviction policy while it runs. Every
+// candidate also runs as a miniature shadow cache: only pages sampled by
+// spatialHash() at rate R are fed to it, and it gets R * capacity frames, so
+// its miss ratio tracks the full-size policy's (Waldspurger et al., USENIX
+// ATC 2017) at a fraction of the cost. R is chosen so every shadow has about
+// SHADOW_FRAMES frames. The real cache starts on the first candidate; at the
+// end of every window of `window` references it moves to the shadow with the
+// fewest misses in that window, when that beats the current policy's shadow
+// by more than SWITCH_MARGIN. The new policy is warmed with the resident
+// pages, least recently used first (the last `capacity` references give the
+// order), so a switch loads and drops nothing. Only the resident set carries
+// over: the shadow samples other pages at another size, so its ghost lists,
+// frequencies and stacks cannot be handed on, and the new policy starts with
+// empty history: every resident page counts as seen once. Until about
+// `capacity` references have rebuilt it, the scan-resistant policies (ARC,
+// 2Q, LIRS, CAR, CLOCK-Pro) act close to LRU and LFU has no frequencies to
+// go by; the margin and the window length keep this cost rare. Windows are
+// recorded whether or not the run is traced. The candidates and their order
+// come from allPolicies().
+vector<PolicyFactory> adaptiveCandidates(const SimSettings& settings);
+
+class AdaptivePolicy {
+public:
+    static constexpr int SHADOW_FRAMES = 256;
+    static constexpr double SWITCH_MARGIN = 0.05;
+
+    // One closed window: the policy that served it, the one chosen for the
+    // next window and every shadow's miss ratio over its sampled references.
+    struct Window {
+        long long end;
+        int served, next;
+        vector<double> missRatio;
+    };
+
+    AdaptivePolicy(int capacity, const SimSettings& settings)
+        : capacity(capacity), window(max(1LL, settings.adaptWindow)), candidates(adaptiveCandidates(settings)),
+          rate(min(1.0, double(SHADOW_FRAMES) / capacity)), threshold(uint64_t(rate * 4294967296.0)),
+          current(0), since(0), position(0), sampled(0), recent(capacity),
+          windowMisses(candidates.size(), 0), served(candidates.size(), 0) {
+        int shadowFrames = max(1, (int)llround(capacity * rate));
+        for (const PolicyFactory& c : candidates) shadows.emplace_back(c.make(shadowFrames));
+        real.reset(candidates[current].make(capacity));
+    }
+
+    bool access(int page) {
+        bool hit = real->push(page) == 1;
+        recent[position % capacity] = page;
+        if ((spatialHash(page) >> 32) < threshold) {
+            for (size_t i = 0; i < shadows.size(); ++i) windowMisses[i] += shadows[i]->push(page) == 0;
+            sampled++;
+        }
+        if (++position % window == 0) endWindow();
+        return hit;
+    }
+
+    const vector<int>& frames() const { return real->frames(); }
+    FrameChange lastLoad() const { return real->lastLoad(); }
+
+    // Switch timeline (up to MAX_LISTED switches) and the share of references
+    // each policy served.
+    void report(ostream& out) {
+        static const int MAX_LISTED = 40;
+        served[current] += position - since;
+        since = position;
+        out << "Adaptive selection: " << candidates.size() << " shadow caches of " << max(1, (int)llround(capacity * rate))
+            << " frames sampling " << fixed << setprecision(2) << 100 * rate << "% of pages, window " << window << " references\n";
+        int switches = 0;
+        for (const Window& w : history) {
+            if (w.next == w.served) continue;
+            if (++switches <= MAX_LISTED) {
+                out << "  at " << setw(12) << left << w.end << candidates[w.served].name << " -> " << candidates[w.next].name
+                    << " (shadow miss ratio " << 100 * w.missRatio[w.served] << "% -> " << 100 * w.missRatio[w.next] << "%)\n";
+            }
+        }
+        if (switches > MAX_LISTED) out << "  ... " << switches - MAX_LISTED << " more switches in adaptive.csv\n";
+        out << "Switches: " << switches << "\nReferences served by each policy:\n";
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (served[i] == 0) continue;
+            out << "  " << setw(20) << left << candidates[i].name << fixed << setprecision(2) << 100.0 * served[i] / max(1LL, position) << "%\n";
+        }
+
+    }
+
+    // Every closed window with each shadow's miss ratio, as CSV.
+    bool writeHistory(const string& path) const {
+        ofstream csv(path);
+        csv << "WindowEnd,Served,Next";
+        for (const PolicyFactory& c : candidates) csv << "," << c.name << "MissRatio";
+        csv << "\n";
+        for (const Window& w : history) {
+            csv << w.end << "," << candidates[w.served].name << "," << candidates[w.next].name;
+            for (double m : w.missRatio) csv << "," << fixed << setprecision(4) << m;
+            csv << "\n";
+        }
+        return (bool)csv;
+    }
+
+private:
+    void endWindow() {
+        int best = current;
+        for (size_t i = 0; i < shadows.size(); ++i) {
+            if (windowMisses[i] < windowMisses[best]) best = i;
+        }
+        int next = windowMisses[best] * (1 + SWITCH_MARGIN) < windowMisses[current] ? best : current;
+        Window w{position, current, next, vector<double>(shadows.size(), 0.0)};
+        for (size_t i = 0; i < shadows.size(); ++i) w.missRatio[i] = sampled > 0 ? double(windowMisses[i]) / sampled : 0.0;
+        history.push_back(std::move(w));
+        if (next != current) switchTo(next);
+        fill(windowMisses.begin(), windowMisses.end(), 0);
+        sampled = 0;
+    }
+
+    // Rebuilds the real cache on another policy with the same resident set:
+    // pages absent from the recent references first, then the rest in the
+    // order of their last recent reference.
+    void switchTo(int next) {
+        served[current] += position - since;
+        since = position;
+        current = next;
+        PageTable latest(capacity); // resident page -> 1 + ring offset of its last reference, 0 if none
+        vector<int> resident;
+        for (int page : real->frames()) {
+            if (page < 0) continue;
+            resident.push_back(page);
+            latest.set(page, 0);
+        }
+        long long count = min<long long>(position, capacity);
+        for (long long k = 0; k < count; ++k) {
+            int page = recent[(position - count + k) % capacity];
+            if (latest.find(page) >= 0) latest.set(page, k + 1);
+        }
+        real.reset(candidates[current].make(capacity));
+        for (int page : resident) {
+            if (latest.find(page) == 0) real->push(page);
+        }
+        for (long long k = 0; k < count; ++k) {
+            int page = recent[(position - count + k) % capacity];
+            if (latest.find(page) == k + 1) real->push(page);
+        }
+    }
+
+    int capacity;
+    long long window;
+    vector<PolicyFactory> candidates;
+    double rate;
+    uint64_t threshold;
+    int current;
+    long long since, position, sampled;
+    vector<int> recent; // ring of the last `capacity` references
+    unique_ptr<StreamPolicy> real;
+    vector<unique_ptr<StreamPolicy>> shadows;
+    vector<long long> windowMisses, served;
+    vector<Window> history;
+};
+
+pair<long long, long long> adaptive(PageView pages, int capacity, ostream& out, ostream& csv, bool trace, const CostModel* cost, const SimSettings& settings) {
+    AdaptivePolicy policy(capacity, settings);
+    pair<long long, long long> counts = simulate("Adaptive", policy, pages, out, csv, trace, cost);
+    policy.report(out);
+    if (trace && policy.writeHistory("adaptive.csv")) out << "Window history written to adaptive.csv\n";
+    return counts;
+}
+
+// Every policy, one row each, in report order. run() is the standalone run
+// on the statically dispatched simulate() (menu options, bench); make()
+// builds the online form used by sweeps, --stream, --multi and Adaptive. It
+// is empty for Optimal, which needs the whole trace, so those callers supply
+// their own. A nonzero adaptiveRank makes the policy an Adaptive candidate;
+// candidates are ordered by rank and Adaptive starts on the first.
+struct PolicyRun {
+    string name;
+    function<pair<long long, long long>(PageView, int, ostream&, ostream&)> run;
+    function<StreamPolicy*(int capacity)> make;
+    int adaptiveRank;
+};
+
+vector<PolicyRun> allPolicies(const SimSettings& settings) {
+    int decay = settings.lfuDecay, tick = settings.agingTick, bits = settings.agingBits;
+    vector<CustomRuleEntry> rules = customRules();
+    return {
+        {"FIFO", [](PageView p, int c, ostream& o, ostream& v) { return fifo(p, c, o, v, false, nullptr); },
+         [](int c) -> StreamPolicy* { return new OnlinePolicy<FifoPolicy>(c); }, 7},
+        {"LRU", [](PageView p, int c, ostream& o, ostream& v) { return lru(p, c, o, v, false, nullptr); },
+         [](int c) -> StreamPolicy* { return new OnlinePolicy<LruPolicy>(c); }, 6},
+        {"Optimal", [](PageView p, int c, ostream& o, ostream& v) { return optimal(p, c, o, v, false, nullptr); }, nullptr, 0},
+        {"Second Chance", [](PageView p, int c, ostream& o, ostream& v) { return secondChance(p, c, o, v, false, nullptr); },
+         [](int c) -> StreamPolicy* { return new OnlinePolicy<ClockPolicy>(c, 1); }, 0},
+        {"GCLOCK", [](PageView p, int c, ostream& o, ostream& v) { return gclock(p, c, o, v, false, nullptr); },
+         [](int c) -> StreamPolicy* { return new OnlinePolicy<ClockPolicy>(c, GCLOCK_MAX_COUNT); }, 0},
+        {"CLOCK-Pro", [](PageView p, int c, ostream& o, ostream& v) { return clockPro(p, c, o, v, false, nullptr); },
+         [](int c) -> StreamPolicy* { return new OnlinePolicy<ClockProPolicy>(c); }, 5},
+        {"ARC", [](PageView p, int c, ostream& o, ostream& v) { return arc(p, c, o, v, false, nullptr); },
+         [](int c) -> StreamPolicy* { return new OnlinePolicy<ArcPolicy>(c); }, 1},
+        {"2Q", [](PageView p, int c, ostream& o, ostream& v) { return twoQ(p, c, o, v, false, nullptr); },
+         [](int c) -> StreamPolicy* { return new OnlinePolicy<TwoQPolicy>(c); }, 4},
+        {"LIRS", [](PageView p, int c, ostream& o, ostream& v) { return lirs(p, c, o, v, false, nullptr); },
+         [](int c) -> StreamPolicy* { return new OnlinePolicy<LirsPolicy>(c); }, 2},
+        {"CAR", [](PageView p, int c, ostream& o, ostream& v) { return car(p, c, o, v, false, nullptr); },
+         [](int c) -> StreamPolicy* { return new OnlinePolicy<CarPolicy>(c); }, 3},
+        {"Adaptive", [settings](PageView p, int c, ostream& o, ostream& v) { return adaptive(p, c, o, v, false, nullptr, settings); },
+         [settings](int c) -> StreamPolicy* { return new OnlinePolicy<AdaptivePolicy>(c, settings); }, 0},
+        {decay > 0 ? "LFU (Decay " + to_string(decay) + ")" : "LFU",
+         [decay](PageView p, int c, ostream& o, ostream& v) { return lfu(p, c, o, v, false, nullptr, decay); },
+         [decay](int c) -> StreamPolicy* { return new OnlinePolicy<FrequencyPolicy>(c, false, decay); }, 8},
+        {"MFU", [](PageView p, int c, ostream& o, ostream& v) { return mfu(p, c, o, v, false, nullptr); },
+         [](int c) -> StreamPolicy* { return new OnlinePolicy<FrequencyPolicy>(c, true, 0); }, 9},
+        {tick != 1 || bits != 8 ? "Aging (" + to_string(bits) + "-bit, tick " + to_string(tick) + ")" : "Aging",
+         [tick, bits](PageView p, int c, ostream& o, ostream& v) { return aging(p, c, o, v, false, nullptr, tick, bits); },
+         [tick, bits](int c) -> StreamPolicy* {
+             if (bits == 32) return new OnlinePolicy<AgingPolicy<uint32_t>>(c, tick);
+             if (bits == 16) return new OnlinePolicy<AgingPolicy<uint16_t>>(c, tick);
+             return new OnlinePolicy<AgingPolicy<uint8_t>>(c, tick);
+         }, 0},
+        {"Custom (Fewest in Window)", [](PageView p, int c, ostream& o, ostream& v) { return custom(p, c, o, v, false, nullptr, 1, 4); },
+         [rules](int c) -> StreamPolicy* { return new OnlineCustom(c, rules[0].make(4)); }, 0},
+        {"Custom (Even Priority)", [](PageView p, int c, ostream& o, ostream& v) { return custom(p, c, o, v, false, nullptr, 2, 4); },
+         [rules](int c) -> StreamPolicy* { return new OnlineCustom(c, rules[1].make(4)); }, 0},
+    };
+}
+
+vector<PolicyFactory> adaptiveCandidates(const SimSettings& settings) {
+    vector<PolicyRun> table = allPolicies(settings);
+    stable_sort(table.begin(), table.end(), [](const PolicyRun& a, const PolicyRun& b) { return a.adaptiveRank < b.adaptiveRank; });
+    vector<PolicyFactory> candidates;
+    for (const PolicyRun& p : table) {
+        if (p.adaptiveRank > 0) candidates.push_back({p.name, p.make});
+    }
+    return candidates;
+}
+
+struct StreamRun {
+    string name;
+    unique_ptr<StreamPolicy> policy;
+    long long hits = 0, faults = 0, windowHits = 0, windowRefs = 0;
+    steady_clock::duration time = steady_clock::duration(0);
+
+    void record(int outcome) {
+        if (outcome < 0) return;
+        hits += outcome;
+        faults += 1 - outcome;
+        windowHits += outcome;
+        windowRefs++;
+    }
+};
+
+// Every online policy except Optimal, in the same order as allPolicies().
+vector<PolicyFactory> onlineFactories(const SimSettings& settings) {
+    vector<PolicyFactory> factories;
+    for (const PolicyRun& p : allPolicies(settings)) {
+        if (p.make) factories.push_back({p.name, p.make});
+    }
+    return factories;
+}
+
+// Every online policy in the same order as allPolicies(), with the given
+// policy standing in for Optimal.
+vector<StreamRun> onlinePolicies(int capacity, const SimSettings& settings, const string& optimalName, StreamPolicy* optimal) {
+    vector<StreamRun> runs;
+    auto add = [&runs](const string& name, StreamPolicy* policy) {
+        runs.emplace_back();
+        runs.back().name = name;
+        runs.back().policy.reset(policy);
+    };
+    for (const PolicyRun& p : allPolicies(settings)) {
+        if (p.make) add(p.name, p.make(capacity));
+        else add(optimalName, optimal);
+    }
+    return runs;
+}
+
+struct SweepResult {
+    string name;
+    int capacity;
+    pair<long long, long long> counts;
+    CostReport cost;
+    string report, csv;
+};
+
+// Fused sweep: the trace is walked in cache-sized TRACE_BLOCK blocks, each
+// read (or on a packed trace decoded) once into a shared buffer, and every
+// (policy, capacity) pair is fed that block while it is still in cache, so
+// the trace streams from memory once per sweep instead of once per pair.
+// Each pair's share of a block is a task on the work-stealing pool, so idle
+// workers take pairs from ones still busy with slow policies; the next block
+// is read once the whole block is done. pushBlock() keeps the policy's loop
+// free of per-reference virtual calls. One shared forward pass supplies
+// Optimal's next uses for all capacities (its cost is charged to Optimal's
+// time). Results come back ordered by capacity, then policy, and match the
+// standalone runs. Every run also goes through settings.cost: the outcomes
+// of each block are replayed into the run's CostMeter after the block,
+// outside the timed section. Instrumentation counters cover only the
+// pushBlock() calls of their run. The number of blocks read is added to
+// *blocksRead when given.
+vector<SweepResult> runSweep(PageView pages, const vector<int>& capacities, int threads, const SimSettings& settings, size_t* blocksRead = nullptr) {
+    auto start = steady_clock::now();
+    TraceSummary summary = summarizeTrace(pages, true);
+    double setupMs = duration<double, milli>(steady_clock::now() - start).count();
+
+    vector<StreamRun> runs;
+    for (int capacity : capacities) {
+        for (StreamRun& r : onlinePolicies(capacity, settings, "Optimal", new OnlinePolicy<OptimalPolicy>(capacity, NextUseCursor(summary.nextUse)))) {
+            runs.push_back(std::move(r));
+        }
+    }
+
+    vector<CostMeter> meters(runs.size(), CostMeter(settings.cost));
+    vector<RunCounters> counters(runs.size());
+    vector<int> scratch(pages.packed ? TRACE_BLOCK : 0);
+    const int* block = nullptr;
+    size_t from = 0, n = 0;
+    vector<function<void()>> tasks;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        tasks.push_back([&runs, &meters, &counters, &pages, &block, &from, &n, i] {
+            StreamRun& r = runs[i];
+            uint8_t hit[TRACE_BLOCK];
+            {
+                CounterScope scope(counters[i]);
+                auto blockStart = steady_clock::now();
+                r.hits += r.policy->pushBlock(block, n, hit);
+                r.time += steady_clock::now() - blockStart;
+            }
+            for (size_t k = 0; k < n; ++k) meters[i].record(block[k], pages.isWrite(from + k), hit[k]);
+        });
+    }
+    WorkStealingPool pool(threads);
+    pool.runRounds(tasks, pages.blocks(), [&](size_t b) {
+        block = pages.block(b, scratch.data());
+        from = b * TRACE_BLOCK;
+        n = pages.blockSize(b);
+        if (blocksRead) ++*blocksRead;
+    });
+    for (size_t i = 0; i < runs.size(); ++i) meters[i].finish(runs[i].policy->frames());
+
+    vector<SweepResult> results(runs.size());
+    size_t perCapacity = runs.size() / capacities.size();
+    for (size_t i = 0; i < runs.size(); ++i) {
+        StreamRun& r = runs[i];
+        SweepResult& result = results[i];
+        result.name = r.name;
+        result.capacity = capacities[i / perCapacity];
+        r.faults = pages.size() - r.hits;
+        double ms = duration<double, milli>(r.time).count() + (r.name == "Optimal" ? setupMs : 0);
+        ostringstream report, csv;
+        result.cost = meters[i].report();
+        printSummary(r.name, r.hits, r.faults, pages.size(), ms, report, csv, &result.cost, &counters[i]);
+        result.counts = {r.hits, r.faults};
+        result.report = report.str();
+        result.csv = csv.str();
+    }
+    return results;
+}
+
+// Streaming simulation
+// Reads references from `in` chunk by chunk and advances every policy over
+// each chunk, so memory stays constant however long the input runs. Every
+// `window` references a row of hit rates over that window is printed;
+// Optimal's row covers the references it decided in the window, which lag
+// the input by the lookahead. The analyzer sees every reference too; its
+// per-page state grows with the number of distinct pages only. Summaries for
+// the whole stream and the pattern analysis follow at the end of input.
+void streamSimulate(TraceReader& in, int capacity, const SimSettings& settings, int lookahead, long long window, AccessAnalyzer& analyzer, ostream& out, ostream& csv) {
+    vector<StreamRun> runs = onlinePolicies(capacity, settings, "Optimal (Lookahead " + to_string(lookahead) + ")", new OnlineLookahead(capacity, lookahead));
+    vector<int> chunk(1 << 16);
+    long long seen = 0;
+    PageTable dense;
+    int distinct = 0;
+
+    out << setw(14) << left << "References";
+    for (const StreamRun& r : runs) out << " | " << r.name;
+    out << "\n" << flush;
+
+    auto snapshot = [&] {
+        out << setw(14) << left << seen;
+        for (StreamRun& r : runs) {
+            out << " | " << setw(r.name.size()) << right << fixed << setprecision(2)
+                << (r.windowRefs > 0 ? 100.0 * r.windowHits / r.windowRefs : 0.0) << left;
+            r.windowHits = r.windowRefs = 0;
+        }
+        out << "\n" << flush;
+    };
+
+    size_t got;
+    while ((got = in.read(chunk.data(), chunk.size())) > 0) {
+        for (size_t i = 0; i < got; ++i) {
+            int page = chunk[i];
+            int id = dense.find(page);
+            if (id < 0) {
+                id = distinct++;
+                dense.set(page, id);
+            }
+            analyzer.add(page, id);
+        }
+
+        // Split the chunk at snapshot boundaries, then run each piece through
+        // every policy in turn.
+        for (size_t from = 0; from < got;) {
+            size_t to = min<size_t>(got, from + (window - seen % window));
+            for (StreamRun& r : runs) {
+                auto start = steady_clock::now();
+                for (size_t i = from; i < to; ++i) r.record(r.policy->push(chunk[i]));
+                r.time += steady_clock::now() - start;
+            }
+            seen += to - from;
+            from = to;
+            if (seen % window == 0) snapshot();
+        }
+    }
+    bool settled = false;
+    for (StreamRun& r : runs) {
+        for (int outcome; (outcome = r.policy->flush()) >= 0; settled = true) r.record(outcome);
+    }
+    if (seen % window != 0 || settled) snapshot();
+    if (!in.ok()) cerr << "Input error; stopped after " << seen << " references.\n";
+
+    for (StreamRun& r : runs) printSummary(r.name, r.hits, r.faults, seen, duration<double, milli>(r.time).count(), out, csv);
+    analyzer.finish();
+    reportPattern(analyzer, out);
+}
+
+// Multi-process simulation
+// Runs several processes, each with its own trace and address space, on one
+// CPU and one paging device under a round-robin scheduler. A process runs
+// for up to `quantum` references (each costs cpuNs of CPU time) and blocks
+// on every page fault until the paging device, which serves faults in
+// arrival order, has read its page in; the CPU meanwhile runs the next ready
+// process. With global replacement all processes share one policy over
+// `frames` frames (process i's pages are offset into a disjoint id range);
+// with local replacement every process owns a policy over its allocation.
+// Allocators:
+//   equal - frames / active processes, no load control
+//   ws    - a process asks for its working set: the distinct pages in its
+//           last `window` references (Denning)
+//   pff   - a process grows its demand by a quarter when its fault rate over
+//           the last `window` references exceeds pffHigh and, below pffLow,
+//           shrinks it by an eighth but never under the pages it used in
+//           that window (page-fault frequency)
+// Under ws and pff the demands must fit in memory: while they do not, the
+// highest-numbered active process is suspended (the system is thrashing),
+// and suspended processes are resumed in order once their demand fits
+// again. A suspended process loses its local frames; under global
+// replacement its pages simply age out of the shared policy.
+struct MultiprogramSpec {
+    string policy = "LRU";
+    bool global = true;
+    string allocator = "equal";    // equal, ws or pff
+    int processes = 0;             // 0 = one per trace; traces are reused round-robin
+    long long quantum = 1000;      // references per time slice
+    long long window = 10000;      // working-set window and PFF interval, in references
+    double pffLow = 0.0005, pffHigh = 0.002; // faults per reference
+    double cpuNs = 1000;           // CPU time per reference
+};
+
+// Outcome of running the first `degree` processes together.
+struct MultiprogramResult {
+    struct Process {
+        int trace;
+        long long references = 0, faults = 0, suspensions = 0;
+        double finishNs = 0;
+    };
+    int degree;
+    vector<Process> processes;
+    double makespanNs = 0, cpuNs = 0, diskNs = 0;
+    long long suspensions = 0;
+
+    long long references() const {
+        long long sum = 0;
+        for (const Process& p : processes) sum += p.references;
+        return sum;
+    }
+    long long faults() const {
+        long long sum = 0;
+        for (const Process& p : processes) sum += p.faults;
+        return sum;
+    }
+};
+
+class MultiprogramSim {
+public:
+    MultiprogramSim(const vector<PageView>& traces, const vector<int>& offsets, int degree, int frames,
+                    const PolicyFactory& factory, const MultiprogramSpec& spec, const CostModel& cost)
+        : spec(spec), cost(cost), factory(factory), frames(frames), rng(0x4D554C54) {
+        result.degree = degree;
+        for (int i = 0; i < degree; ++i) {
+            procs.emplace_back();
+            Proc& p = procs.back();
+            p.trace = i % traces.size();
+            p.pages = traces[p.trace];
+            p.offset = offsets[i];
+            p.demand = max(1, frames / degree);
+        }
+        if (spec.global) shared.reset(factory.make(frames));
+    }
+
+    MultiprogramResult run() {
+        int remaining = procs.size();
+        for (size_t i = 0; i < procs.size(); ++i) {
+            if (procs[i].pages.empty()) finish(i, 0, remaining);
+            else ready.push_back(i);
+        }
+        balance();
+        while (remaining > 0) {
+            while (!wakeups.empty() && wakeups.top().first <= now) {
+                pair<double, int> event = wakeups.top();
+                wakeups.pop();
+                wake(event.second, event.first, remaining);
+            }
+            if (ready.empty()) {
+                if (wakeups.empty()) break;
+                now = wakeups.top().first;
+                continue;
+            }
+            int i = ready.front();
+            ready.pop_front();
+            Proc& p = procs[i];
+            p.queued = false;
+            bool blocked = false;
+            for (long long q = 0; q < spec.quantum && !p.suspended && p.next < p.pages.size(); ++q) {
+                blocked = !reference(i);
+                if (blocked) break;
+            }
+            if (blocked) continue;
+            if (p.next == p.pages.size()) finish(i, now, remaining);
+            else if (!p.suspended) enqueue(i);
+        }
+        result.makespanNs = now;
+        for (const Proc& p : procs) {
+            result.processes.push_back({p.trace, (long long)p.next, p.faults, p.suspensions, p.finishNs});
+            result.suspensions += p.suspensions;
+        }
+        return result;
+    }
+
+private:
+    struct Proc {
+        int trace, offset, demand, frames = 0;
+        PageView pages;
+        size_t next = 0;
+        long long faults = 0, suspensions = 0, windowFaults = 0, workingSet = 0;
+        bool blocked = false, suspended = false, done = false, queued = false;
+        double finishNs = 0;
+        PageTable dense;          // page -> dense id
+        vector<int64_t> lastUse; // dense id -> index of its last reference
+        unique_ptr<StreamPolicy> policy;
+    };
+
+    // Runs the next reference of process i; false when it faulted and blocked.
+    bool reference(int i) {
+        Proc& p = procs[i];
+        int64_t t = p.next++;
+        int page = p.pages[t];
+        now += spec.cpuNs;
+        result.cpuNs += spec.cpuNs;
+        trackWorkingSet(p, t, page);
+        bool hit = spec.global ? shared->push(p.offset + page) == 1 : p.policy->push(page) == 1;
+        if (!hit) {
+            p.faults++;
+            p.windowFaults++;
+            double service = cost.fault.sample(rng);
+            diskFree = max(now, diskFree) + service;
+            result.diskNs += service;
+            p.blocked = true;
+            wakeups.push({diskFree, i});
+        }
+        if ((t + 1) % spec.window == 0) review(p);
+        return hit;
+    }
+
+    // Keeps the number of distinct pages among the last `window` references.
+    void trackWorkingSet(Proc& p, int64_t t, int page) {
+        int64_t oldest = t - spec.window;
+        if (oldest >= 0 && p.lastUse[p.dense.find(p.pages[oldest])] == oldest) p.workingSet--;
+        int id = p.dense.find(page);
+        if (id < 0) {
+            id = p.lastUse.size();
+            p.dense.set(page, id);
+            p.lastUse.push_back(-1);
+        }
+        int64_t last = p.lastUse[id];
+        if (last < 0 || last <= oldest) p.workingSet++;
+        p.lastUse[id] = t;
+    }
+
+    // End of one of the process's windows: the allocator revises its demand.
+    void review(Proc& p) {
+        if (spec.allocator == "ws") {
+            p.demand = max<long long>(1, p.workingSet);
+        } else if (spec.allocator == "pff") {
+            double rate = double(p.windowFaults) / spec.window;
+            if (rate > spec.pffHigh) p.demand = min(frames, p.demand + max(1, p.demand / 4));
+            else if (rate < spec.pffLow) p.demand = max<long long>({1, p.workingSet, p.demand - max(1, p.demand / 8)});
+        }
+        p.windowFaults = 0;
+        balance();
+    }
+
+    void wake(int i, double at, int& remaining) {
+        Proc& p = procs[i];
+        p.blocked = false;
+        if (p.next == p.pages.size()) finish(i, at, remaining);
+        else if (!p.suspended) enqueue(i);
+    }
+
+    void enqueue(int i) {
+        if (procs[i].queued) return;
+        procs[i].queued = true;
+        ready.push_back(i);
+    }
+
+    void finish(int i, double at, int& remaining) {
+        Proc& p = procs[i];
+        p.done = true;
+        p.finishNs = at;
+        p.policy.reset();
+        p.frames = 0;
+        remaining--;
+        balance();
+    }
+
+    bool active(const Proc& p) const { return !p.done && !p.suspended; }
+
+    // Load control and, under local replacement, the frame allocation.
+    void balance() {
+        if (spec.allocator != "equal") {
+            long long demand = 0;
+            int running = 0;
+            for (const Proc& p : procs) {
+                if (active(p)) {
+                    demand += p.demand;
+                    running++;
+                }
+            }
+            for (int i = procs.size() - 1; i >= 0 && demand > frames && running > 1; --i) {
+                Proc& p = procs[i];
+                if (!active(p)) continue;
+                p.suspended = true;
+                p.suspensions++;
+                p.policy.reset();
+                p.frames = 0;
+                demand -= p.demand;
+                running--;
+            }
+            for (size_t i = 0; i < procs.size(); ++i) {
+                Proc& p = procs[i];
+                if (p.done || !p.suspended) continue;
+                if (running > 0 && demand + p.demand > frames) break;
+                p.suspended = false;
+                demand += p.demand;
+                running++;
+                if (!p.blocked) enqueue(i);
+            }
+        }
+        if (spec.global) return;
+
+        int running = 0;
+        for (const Proc& p : procs) running += active(p);
+        int given = 0;
+        for (Proc& p : procs) {
+            if (!active(p)) continue;
+            int share = spec.allocator == "equal" ? frames / running + (given++ < frames % running) : min(p.demand, frames);
+            resize(p, max(1, share));
+        }
+    }
+
+    // Rebuilds a process's local policy with a new allocation, reloading its
+    // most recently used resident pages (oldest first) so a resize does not
+    // fault them in again. Resident pages not referenced within the last
+    // 16 allocations' worth of references are dropped.
+    void resize(Proc& p, int capacity) {
+        if (p.policy && p.frames == capacity) return;
+        unique_ptr<StreamPolicy> policy(factory.make(capacity));
+        if (p.policy) {
+            PageTable resident, seen;
+            for (int page : p.policy->frames()) {
+                if (page >= 0) resident.set(page, 0);
+            }
+            vector<int> keep;
+            long long stop = max(0LL, (long long)p.next - 16LL * max(capacity, p.frames));
+            for (long long t = (long long)p.next - 1; t >= stop && (int)keep.size() < capacity && keep.size() < resident.size(); --t) {
+                int page = p.pages[t];
+                if (resident.find(page) < 0 || seen.find(page) >= 0) continue;
+                seen.set(page, 0);
+                keep.push_back(page);
+            }
+            for (size_t k = keep.size(); k-- > 0;) policy->push(keep[k]);
+        }
+        p.policy = std::move(policy);
+        p.frames = capacity;
+    }
+
+    const MultiprogramSpec& spec;
+    const CostModel& cost;
+    const PolicyFactory& factory;
+    int frames;
+    Xoshiro256 rng;
+    vector<Proc> procs;
+    unique_ptr<StreamPolicy> shared;
+    deque<int> ready;
+    priority_queue<pair<double, int>, vector<pair<double, int>>, greater<pair<double, int>>> wakeups;
+    double now = 0, diskFree = 0;
+    MultiprogramResult result;
+};
+
+// Runs the first 1, 2, ..., spec.processes processes together, in parallel
+// across degrees, and reports per-process fault rates and the throughput of
+// each degree of multiprogramming. Writes multiprog.csv (one row per
+// degree) and multiprog_processes.csv (one row per process and degree).
+bool multiprogram(const vector<string>& names, const vector<PageView>& traces, int frames, const MultiprogramSpec& spec,
+                  const SimSettings& settings, int threads, ostream& out) {
+    const PolicyFactory* factory = nullptr;
+    vector<PolicyFactory> factories = onlineFactories(settings);
+    auto lower = [](string s) {
+        for (char& c : s) c = tolower(c);
+        return s;
+    };
+    for (const PolicyFactory& f : factories) {
+        if (lower(f.name) == lower(spec.policy)) factory = &f;
+    }
+    if (!factory) {
+        // Optimal is left out: its future depends on the interleaving being simulated.
+        cerr << "Unknown policy '" << spec.policy << "'; choose one of:";
+        for (const PolicyFactory& f : factories) cerr << " \"" << f.name << "\"";
+        cerr << "\n";
+        return false;
+    }
+
+    // Disjoint page id ranges, so processes never share a page.
+    int processes = spec.processes > 0 ? spec.processes : traces.size();
+    vector<int> offsets;
+    long long next = 0;
+    for (int i = 0; i < processes; ++i) {
+        PageView view = traces[i % traces.size()];
+        int top = -1;
+        for (int page : view) top = max(top, page);
+        offsets.push_back(next);
+        next += top + 1LL;
+        if (next > INT_MAX) {
+            cerr << "The processes' pages do not fit in 32-bit page ids\n";
+            return false;
+        }
+    }
+
+    vector<MultiprogramResult> results(processes);
+    vector<function<void()>> tasks;
+    for (int d = 1; d <= processes; ++d) {
+        tasks.push_back([&, d] {
+            MultiprogramSim sim(traces, offsets, d, frames, *factory, spec, settings.cost);
+            results[d - 1] = sim.run();
+        });
+    }
+    WorkStealingPool pool(threads);
+    pool.run(tasks);
+
+    out << "\n=== MULTIPROGRAMMING: " << factory->name << ", " << (spec.global ? "global" : "local") << " replacement, "
+        << spec.allocator << " allocation, " << frames << " frames ===\n";
+    out << "Quantum " << spec.quantum << " references, " << spec.cpuNs / 1000 << " us CPU per reference, page fault "
+        << settings.cost.fault.describe() << "\n\n";
+    out << setw(7) << right << "Degree" << setw(14) << "References" << setw(12) << "Faults" << setw(11) << "Fault %"
+        << setw(16) << "Refs/ms" << setw(8) << "CPU %" << setw(8) << "Disk %" << setw(13) << "Suspensions" << "\n";
+    ofstream csv("multiprog.csv"), perProcess("multiprog_processes.csv");
+    csv << "Degree,References,Faults,FaultRate,MakespanMs,RefsPerMs,CpuUtilization,DiskUtilization,Suspensions\n";
+    perProcess << "Degree,Process,Trace,References,Faults,FaultRate,Suspensions,FinishMs\n";
+    for (const MultiprogramResult& r : results) {
+        double ms = r.makespanNs / 1e6, span = max(1.0, r.makespanNs);
+        double faultRate = 100.0 * r.faults() / max(1LL, r.references());
+        double throughput = r.references() / max(1e-9, ms);
+        out << setw(7) << r.degree << setw(14) << r.references() << setw(12) << r.faults() << fixed << setprecision(2)
+            << setw(11) << faultRate << setw(16) << throughput << setw(8) << 100 * r.cpuNs / span << setw(8)
+            << 100 * r.diskNs / span << setw(13) << r.suspensions << "\n";
+        csv << r.degree << "," << r.references() << "," << r.faults() << "," << faultRate << "," << ms << "," << throughput
+            << "," << r.cpuNs / span << "," << r.diskNs / span << "," << r.suspensions << "\n";
+        for (size_t i = 0; i < r.processes.size(); ++i) {
+            const MultiprogramResult::Process& p = r.processes[i];
+            perProcess << r.degree << "," << i << "," << names[p.trace] << "," << p.references << "," << p.faults << ","
+                       << 100.0 * p.faults / max(1LL, p.references) << "," << p.suspensions << "," << p.finishNs / 1e6 << "\n";
+        }
+    }
+
+    const MultiprogramResult& last = results.back();
+    out << "\nProcesses at degree " << last.degree << ":\n";
+    out << setw(8) << "Process" << "  " << setw(24) << left << "Trace" << right << setw(12) << "References" << setw(10)
+        << "Faults" << setw(11) << "Fault %" << setw(13) << "Suspensions" << setw(14) << "Finish (ms)" << "\n";
+    for (size_t i = 0; i < last.processes.size(); ++i) {
+        const MultiprogramResult::Process& p = last.processes[i];
+        out << setw(8) << i << "  " << setw(24) << left << names[p.trace] << right << setw(12) << p.references << setw(10)
+            << p.faults << setw(11) << 100.0 * p.faults / max(1LL, p.references) << setw(13) << p.suspensions << setw(14)
+            << p.finishNs / 1e6 << "\n";
+    }
+    out << "\nWrote multiprog.csv and multiprog_processes.csv\n";
+    return true;
+}
+
+#ifndef OS_PROJECT_NO_MAIN
+// Main
+// Usage: os_project [--threads N] [--lfu-decay N] [--aging-tick N] [--aging-bits 8|16|32]
+//                   [--ws-interval N] [--adapt-window N] [--pack] [cost model options] [trace-file [frames]]
+//        os_project --stream <frames> [trace-file|fifo|-] [--lookahead N] [--window N]
+//        os_project --shards <max-frames> [trace-file|fifo|-] [--rate R] [--budget N]
+//        os_project --multi <frames> <trace-file>... [--processes N] [--quantum N] [--policy NAME]
+//                   [--scope global|local] [--allocator equal|ws|pff] [--ws-window N]
+//                   [--pff-low F] [--pff-high F] [--cpu-time T] [--fault-time DIST]
+//        os_project --decode <event-log> [output]
+//        os_project --convert <text-trace> <binary-trace>
+//        os_project --ingest <lackey-trace|-> <binary-trace> [--page-size 4K|2M|1G] [--instructions]
+//        os_project --recover <ingested-trace> <address-list>
+//        os_project --generate <kind> <count> <binary-trace> [--pages N] [--seed S]
+//                   [--zipf A] [--loop N] [--working-set N] [--phase N]
+//                   [--scan-fraction F] [--hot-pages N] [--write-fraction F]
+// Traced menu options log to --event-log (frames.events) and take
+//                   [--trace-every N] [--trace-faults].
+// Cost model options: [--tlb-entries N] [--tlb-ways N] [--tlb-policy lru|fifo|random]
+//                   [--tlb-time T] [--memory-time T] [--walk-levels N] [--page-size 4K|2M|1G]
+//                   [--fault-time DIST] [--writeback-time DIST]
+// with times such as 100ns or 8ms and DIST as accepted by parseServiceTime().
+// A trace file may be whitespace-separated text or the binary format above.
+int main(int argc, char** argv) {
+    int n, capacity = 0, choice;
+    int threads = max(1u, thread::hardware_concurrency());
+    int lookahead = 10000;
+    int pageShift = 12;
+    long long analysisInterval = 10000;
+    double shardsRate = 0;
+    int shardsBudget = 0;
+    bool withInstructions = false;
+    bool pack = false;
+    long long window = 100000;
+    vector<int> input;
+    vector<string> args;
+    SimSettings settings;
+    WorkloadSpec spec;
+    MultiprogramSpec multi;
+    string eventPath = "frames.events";
+    EventSampling sampling;
+    TraceFile traceFile;
+    PageView pages;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) threads = max(1, atoi(argv[++i]));
+        else if (arg == "--lfu-decay" && i + 1 < argc) settings.lfuDecay = max(0, atoi(argv[++i]));
+        else if (arg == "--aging-tick" && i + 1 < argc) settings.agingTick = max(1, atoi(argv[++i]));
+        else if (arg == "--aging-bits" && i + 1 < argc) {
+            int bits = atoi(argv[++i]);
+            settings.agingBits = (bits == 16 || bits == 32) ? bits : 8;
+        }
+        else if (arg == "--lookahead" && i + 1 < argc) lookahead = max(0, atoi(argv[++i]));
+        else if (arg == "--window" && i + 1 < argc) window = max(1LL, atoll(argv[++i]));
+        else if (arg == "--ws-interval" && i + 1 < argc) analysisInterval = max(1LL, atoll(argv[++i]));
+        else if (arg == "--adapt-window" && i + 1 < argc) settings.adaptWindow = max(1LL, atoll(argv[++i]));
+        else if (arg == "--page-size" && i + 1 < argc) {
+            pageShift = parsePageShift(argv[++i]);
+            if (pageShift < 0) {
+                cerr << "Page size must be a power of two, e.g. 4K, 2M or 1G\n";
+                return 1;
+            }
+        }
+        else if (arg == "--instructions") withInstructions = true;
+        else if (arg == "--pack") pack = true;
+        else if (arg == "--rate" && i + 1 < argc) shardsRate = atof(argv[++i]);
+        else if (arg == "--budget" && i + 1 < argc) shardsBudget = max(0, atoi(argv[++i]));
+        else if (arg == "--pages" && i + 1 < argc) spec.pageSpace = max(1, atoi(argv[++i]));
+        else if (arg == "--seed" && i + 1 < argc) spec.seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--zipf" && i + 1 < argc) spec.zipfExponent = atof(argv[++i]);
+        else if (arg == "--loop" && i + 1 < argc) spec.loopLength = max(0, atoi(argv[++i]));
+        else if (arg == "--working-set" && i + 1 < argc) spec.workingSet = max(0, atoi(argv[++i]));
+        else if (arg == "--phase" && i + 1 < argc) spec.phaseLength = max(1LL, atoll(argv[++i]));
+        else if (arg == "--scan-fraction" && i + 1 < argc) spec.scanFraction = atof(argv[++i]);
+        else if (arg == "--hot-pages" && i + 1 < argc) spec.hotPages = max(0, atoi(argv[++i]));
+        else if (arg == "--write-fraction" && i + 1 < argc) spec.writeFraction = atof(argv[++i]);
+        else if (arg == "--tlb-entries" && i + 1 < argc) settings.cost.tlbEntries = max(0, atoi(argv[++i]));
+        else if (arg == "--tlb-ways" && i + 1 < argc) settings.cost.tlbWays = max(1, atoi(argv[++i]));
+        else if (arg == "--tlb-policy" && i + 1 < argc) {
+            settings.cost.tlbPolicy = argv[++i];
+            if (settings.cost.tlbPolicy != "lru" && settings.cost.tlbPolicy != "fifo" && settings.cost.tlbPolicy != "random") {
+                cerr << "TLB policy must be lru, fifo or random\n";
+                return 1;
+            }
+        }
+        else if (arg == "--walk-levels" && i + 1 < argc) settings.cost.walkLevels = max(0, atoi(argv[++i]));
+        else if ((arg == "--tlb-time" || arg == "--memory-time") && i + 1 < argc) {
+            double& ns = arg == "--tlb-time" ? settings.cost.tlbNs : settings.cost.memoryNs;
+            if (!parseDuration(argv[++i], ns)) {
+                cerr << "Bad time for " << arg << ": " << argv[i] << " (e.g. 100ns, 2us)\n";
+                return 1;
+            }
+        }
+        else if ((arg == "--fault-time" || arg == "--writeback-time") && i + 1 < argc) {
+            ServiceTime& t = arg == "--fault-time" ? settings.cost.fault : settings.cost.writeBack;
+            if (!parseServiceTime(argv[++i], t)) {
+                cerr << "Bad distribution for " << arg << ": " << argv[i] << " (e.g. 8ms, exp:8ms, uniform:2ms,12ms, lognormal:8ms,0.5)\n";
+                return 1;
+            }
+            if (arg == "--writeback-time") settings.cost.writeBackSet = true;
+        }
+        else if (arg == "--event-log" && i + 1 < argc) eventPath = argv[++i];
+        else if (arg == "--trace-every" && i + 1 < argc) sampling.every = max(1LL, atoll(argv[++i]));
+        else if (arg == "--trace-faults") sampling.faultsOnly = true;
+        else if (arg == "--processes" && i + 1 < argc) multi.processes = max(0, atoi(argv[++i]));
+        else if (arg == "--quantum" && i + 1 < argc) multi.quantum = max(1LL, atoll(argv[++i]));
+        else if (arg == "--ws-window" && i + 1 < argc) multi.window = max(1LL, atoll(argv[++i]));
+        else if (arg == "--pff-low" && i + 1 < argc) multi.pffLow = atof(argv[++i]);
+        else if (arg == "--pff-high" && i + 1 < argc) multi.pffHigh = atof(argv[++i]);
+        else if (arg == "--policy" && i + 1 < argc) multi.policy = argv[++i];
+        else if (arg == "--scope" && i + 1 < argc) {
+            string scope = argv[++i];
+            if (scope != "global" && scope != "local") {
+                cerr << "Replacement scope must be global or local\n";
+                return 1;
+            }
+            multi.global = scope == "global";
+        }
+        else if (arg == "--allocator" && i + 1 < argc) {
+            multi.allocator = argv[++i];
+            if (multi.allocator != "equal" && multi.allocator != "ws" && multi.allocator != "pff") {
+                cerr << "Allocator must be equal, ws or pff\n";
+                return 1;
+            }
+        }
+        else if (arg == "--cpu-time" && i + 1 < argc) {
+            if (!parseDuration(argv[++i], multi.cpuNs)) {
+                cerr << "Bad time for --cpu-time: " << argv[i] << " (e.g. 1us)\n";
+                return 1;
+            }
+        }
+        else args.push_back(arg);
+    }
+    settings.cost.pageBytes = 1ULL << pageShift;
+
+    if (args.size() == 4 && args[0] == "--generate") {
+        spec.kind = args[1];
+        uint64_t count = strtoull(args[2].c_str(), nullptr, 10);
+        if (!generateTraceFile(spec, count, args[3])) {
+            cerr << "Could not generate a '" << args[1] << "' trace into " << args[3] << "\n";
+            return 1;
+        }
+        cout << "Wrote " << count << " " << spec.kind << " references to " << args[3] << "\n";
+        return 0;
+    }
+
+    if ((args.size() == 2 || args.size() == 3) && args[0] == "--stream") {
+        capacity = atoi(args[1].c_str());
+        string source = args.size() == 3 ? args[2] : "-";
+        TraceReader reader;
+        if (capacity <= 0 || !reader.open(source)) {
+            cerr << "Could not stream from " << source << " with " << args[1] << " frames\n";
+            return 1;
+        }
+        ofstream csv("report.csv");
+        csv << "Algorithm,Hits,Faults,HitRate,MissRate,ExecutionTime(ms),NsPerRef\n";
+        AccessAnalyzer analyzer(analysisInterval);
+        streamSimulate(reader, capacity, settings, lookahead, window, analyzer, cout, csv);
+        return 0;
+    }
+
+    if ((args.size() == 2 || args.size() == 3) && args[0] == "--shards") {
+        long long maxFrames = atoll(args[1].c_str());
+        string source = args.size() == 3 ? args[2] : "-";
+        // A budget alone starts from sampling everything; neither means 1%.
+        double rate = shardsRate > 0 ? min(1.0, shardsRate) : (shardsBudget > 0 ? 1.0 : 0.01);
+        TraceReader reader;
+        if (maxFrames < 1 || !reader.open(source)) {
+            cerr << "Could not build a curve from " << source << " up to " << args[1] << " frames\n";
+            return 1;
+        }
+        ShardsMrc shards(maxFrames, rate, shardsBudget);
+        vector<int> chunk(1 << 16);
+        for (size_t got; (got = reader.read(chunk.data(), chunk.size())) > 0;) {
+            for (size_t i = 0; i < got; ++i) shards.add(chunk[i]);
+        }
+        shards.write("mrc_approx.csv", cout);
+        return reader.ok() ? 0 : 1;
+    }
+
+    if (args.size() >= 3 && args[0] == "--multi") {
+        int frames = atoi(args[1].c_str());
+        vector<unique_ptr<TraceFile>> files;
+        vector<PageView> traces;
+        vector<string> names(args.begin() + 2, args.end());
+        for (const string& name : names) {
+            files.emplace_back(new TraceFile);
+            if (!files.back()->open(name)) {
+                cerr << "Could not read trace file: " << name << "\n";
+                return 1;
+            }
+            traces.push_back(files.back()->view());
+        }
+        if (frames <= 0) {
+            cerr << "Frame count must be positive\n";
+            return 1;
+        }
+        return multiprogram(names, traces, frames, multi, settings, threads, cout) ? 0 : 1;
+    }
+
+    if ((args.size() == 2 || args.size() == 3) && args[0] == "--decode") {
+        ofstream file;
+        if (args.size() == 3) file.open(args[2]);
+        if (!decodeEventLog(args[1], args.size() == 3 ? file : cout)) {
+            cerr << "Could not decode event log " << args[1] << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (args.size() == 3 && args[0] == "--ingest") {
+        IngestStats stats;
+        if (!ingestAddressTrace(args[1], args[2], pageShift, withInstructions, stats)) {
+            cerr << "Could not ingest " << args[1] << " into " << args[2] << "\n";
+            return 1;
+        }
+        cout << "Wrote " << stats.references << " references to " << stats.pages << " distinct "
+             << (1ULL << pageShift) << "-byte pages to " << args[2] << "\n";
+        if (stats.writes > 0) cout << stats.writes << " of them are writes\n";
+        if (stats.skipped > 0) cout << "Skipped " << stats.skipped << " of " << stats.lines << " lines\n";
+        return 0;
+    }
+
+    if (args.size() == 3 && args[0] == "--recover") {
+        if (!recoverAddresses(args[1], args[2])) {
+            cerr << "Could not recover addresses from " << args[1] << " (no remap table?)\n";
+            return 1;
+        }
+        cout << "Wrote page addresses to " << args[2] << "\n";
+        return 0;
+    }
+
+    if (args.size() == 3 && args[0] == "--convert") {
+        if (!traceFile.open(args[1]) || !writeBinaryTrace(args[2], traceFile.view())) {
+            cerr << "Could not convert " << args[1] << " to " << args[2] << "\n";
+            return 1;
+        }
+        cout << "Wrote " << traceFile.view().size() << " references to " << args[2] << "\n";
+        return 0;
+    }
+
+    clearConsole();
+    cout << "===== Smart Memory Management and Algorithm Customization Simulator =====\n";
+
+    if (!args.empty()) {
+        if (!traceFile.open(args[0], pack)) {
+            cerr << "Could not read trace file: " << args[0] << "\n";
+            return 1;
+        }
+        pages = traceFile.view();
+        cout << "Loaded " << pages.size() << " page references from " << args[0] << "\n";
+        if (pages.packed) {
+            size_t packedBytes = pages.packed->byteSize();
+            cout << "Packed into " << fixed << setprecision(2) << packedBytes / 1048576.0 << " MiB ("
+                 << 8.0 * packedBytes / max<size_t>(1, pages.size()) << " bits/reference, "
+                 << 4.0 * pages.size() / max<size_t>(1, packedBytes) << "x smaller)\n";
+        }
+        if (args.size() > 1) capacity = atoi(args[1].c_str());
+    } else {
+        cout<<"Please choose between 1 and 2"<<endl;
+        cout << "1. Manual Input\n2. Auto Random Generation\nChoose Input Method: ";
+        int inputChoice; cin >> inputChoice;
+
+        if (inputChoice == 2) {
+            cout << "Number of page references: ";
+            cin >> n;
+            cout << "Distribution:\n";
+            for (size_t k = 0; k < WORKLOAD_KINDS.size(); ++k) cout << k + 1 << ". " << WORKLOAD_KINDS[k] << "\n";
+            cout << "Choose distribution: ";
+            int kind; cin >> kind;
+            spec.kind = WORKLOAD_KINDS[(kind >= 1 && kind <= (int)WORKLOAD_KINDS.size()) ? kind - 1 : 0];
+            cout << "Number of distinct pages: ";
+            cin >> spec.pageSpace;
+            cout << "Seed (0 = time based): ";
+            cin >> spec.seed;
+            if (spec.seed == 0) spec.seed = time(0);
+            input = generateWorkload(spec, max(0, n));
+            if (n <= 1000) {
+                cout << "Generated: ";
+                for (int x : input) cout << x << " ";
+                cout << "\n";
+            }
+        } else {
+            cout << "Enter number of references: ";
+            cin >> n;
+            input.resize(n);
+            cout << "Enter page references: ";
+            for (int i = 0; i < n; ++i) cin >> input[i];
+            if (!cin || find(input.begin(), input.end(), INT_MIN) != input.end()) {
+                cerr << "Page references must be integers in [" << -INT_MAX << ", " << INT_MAX << "]\n";
+                return 1;
+            }
+        }
+        pages = input;
+    }
+
+    if (pages.empty()) {
+        cerr << "No page references to simulate.\n";
+        return 1;
+    }
+
+    if (capacity <= 0) {
+        cout << "Enter number of frames: ";
+        cin >> capacity;
+    }
+
+    // Pattern Detection
+    AccessAnalyzer analyzer(analysisInterval);
+    summarizeTrace(pages, false, &analyzer);
+    reportPattern(analyzer, cout);
+
+    do {
+        cout << "\n--- Menu ---\n";
+        cout << "1. FIFO\n2. LRU\n3. Optimal\n4. Second Chance\n5. LFU\n6. MFU\n7. Aging\n8. Custom Algorithm\n9. Run All + Report\n10. Clear Console\n11. Miss-Ratio Curve (all frame counts)\n12. Sweep Frame Counts (parallel)\n13. GCLOCK\n14. CLOCK-Pro\n15. Approximate Miss-Ratio Curve (SHARDS)\n16. ARC\n17. 2Q\n18. LIRS\n19. CAR\n20. Adaptive (shadow-cache selection)\n0. Exit\n";
+        cout << "Enter your choice: ";
+        cin >> choice;
+
+        // Only choices that produce results replace the previous report.
+        ofstream report, csv;
+        if ((choice >= 1 && choice <= 9) || (choice >= 12 && choice <= 14) || (choice >= 16 && choice <= 20)) {
+            report.open("report.txt");
+            csv.open("report.csv");
+            if (choice == 12) csv << "Frames,";
+            csv << "Algorithm,Hits,Faults,HitRate,MissRate,ExecutionTime(ms),NsPerRef";
+            csv << ",EATNs,TLBHitRate,WriteBacks,IOBytes";
+            if (COUNTERS_ENABLED) csv << COUNTER_COLUMNS;
+            csv << "\n";
+        }
+
+        map<string, double> hitRates;
+        int customRule = 0, windowSize = 4;
+
+        if (choice == 8) {
+            vector<CustomRuleEntry> rules = customRules();
+            cout << "\n=== Custom Algorithm Designer ===\n";
+            cout << "Choose eviction rule:\n";
+            for (size_t r = 0; r < rules.size(); ++r) cout << r + 1 << ". " << rules[r].description << "\n";
+            cout << "Enter rule choice: ";
+            cin >> customRule;
+            if (customRule >= 1 && customRule <= (int)rules.size() && rules[customRule - 1].usesWindow) {
+                cout << "Enter window size for access counting (e.g., 4): ";
+                cin >> windowSize;
+            }
+        }
+
+        // Single-policy runs record their frame view into the event log; short
+        // traces are decoded straight back onto the console.
+        bool traced = (choice >= 1 && choice <= 8) || choice == 13 || choice == 14 || (choice >= 16 && choice <= 20);
+        if (traced && !frameLog().open(eventPath, sampling)) cerr << "Could not open " << eventPath << "; printing frames instead\n";
+
+        switch (choice) {
+            case 1: fifo(pages, capacity, cout, csv, true, &settings.cost); break;
+            case 2: lru(pages, capacity, cout, csv, true, &settings.cost); break;
+            case 3: optimal(pages, capacity, cout, csv, true, &settings.cost); break;
+            case 4: secondChance(pages, capacity, cout, csv, true, &settings.cost); break;
+            case 5: lfu(pages, capacity, cout, csv, true, &settings.cost, settings.lfuDecay); break;
+            case 6: mfu(pages, capacity, cout, csv, true, &settings.cost); break;
+            case 7: aging(pages, capacity, cout, csv, true, &settings.cost, settings.agingTick, settings.agingBits); break;
+            case 8: custom(pages, capacity, cout, csv, true, &settings.cost, customRule, windowSize); break;
+            case 9: {
+                vector<SweepResult> results = runSweep(pages, {capacity}, threads, settings);
+                map<string, CostReport> costs;
+                for (const SweepResult& r : results) {
+                    report << r.report;
+                    csv << r.csv;
+                    hitRates[r.name] = 100.0 * r.counts.first / pages.size();
+                    costs[r.name] = r.cost;
+                }
+
+                cout << "\n\n=== HIT RATIO GRAPH (TEXT) ===\n";
+                for (map<string, double>::iterator it = hitRates.begin(); it != hitRates.end(); ++it) {
+                    cout << setw(20) << left << it->first << " | ";
+                    int bars = (int)(it->second / 2);
+                    for (int i = 0; i < bars; ++i) cout << "#";
+                    cout << " (" << fixed << setprecision(2) << it->second << "%)\n";
+                }
+
+                // Policies are ranked on latency, not hit rate: write-backs
+                // and TLB behaviour can reorder policies with similar rates.
+                sort(results.begin(), results.end(), [](const SweepResult& a, const SweepResult& b) { return a.cost.eatNs() < b.cost.eatNs(); });
+                cout << "\n=== RANKING BY EFFECTIVE ACCESS TIME ===\n";
+                cout << "Cost model: " << settings.cost.describe() << "\n";
+                for (size_t i = 0; i < results.size(); ++i) {
+                    const SweepResult& r = results[i];
+                    cout << setw(3) << right << i + 1 << ". " << setw(26) << left << r.name << setw(14) << right << fixed << setprecision(2)
+                         << r.cost.eatNs() << " ns  " << setw(10) << r.cost.ioBytes() / 1048576.0 << " MiB I/O  "
+                         << setw(6) << hitRates[r.name] << "% hits\n";
+                }
+
+                double optimalEat = costs["Optimal"].eatNs();
+                string closestAlgo;
+                double minDiff = numeric_limits<double>::max();
+
+                for (map<string, CostReport>::iterator it = costs.begin(); it != costs.end(); ++it) {
+                    string algo = it->first;
+                    double eat = it->second.eatNs();
+                    if (algo == "Optimal") continue;
+                    double diff = abs(eat - optimalEat);
+                    if (diff < minDiff) {
+                        minDiff = diff;
+                        closestAlgo = algo;
+                    }
+                }
+
+                cout << "\n Compare with Optimal:\n";
+                cout << "Optimal EAT        : " << fixed << setprecision(2) << optimalEat << " ns (" << costs["Optimal"].ioBytes() / 1048576.0 << " MiB I/O)\n";
+                cout << "Closest Algorithm  : " << closestAlgo << " (" << costs[closestAlgo].eatNs() << " ns, "
+                     << costs[closestAlgo].ioBytes() / 1048576.0 << " MiB I/O)\n";
+                cout << "Adaptive EAT       : " << costs["Adaptive"].eatNs() << " ns (" << costs["Adaptive"].eatNs() - optimalEat
+                     << " ns above Optimal; hit rate " << hitRates["Adaptive"] << "% vs " << hitRates["Optimal"] << "%)\n";
+
+                cout << "\n Report generated: report.txt and report.csv\n";
+                break;
+            }
+            case 10: clearConsole(); break;
+            case 13: gclock(pages, capacity, cout, csv, true, &settings.cost); break;
+            case 14: clockPro(pages, capacity, cout, csv, true, &settings.cost); break;
+            case 16: arc(pages, capacity, cout, csv, true, &settings.cost); break;
+            case 17: twoQ(pages, capacity, cout, csv, true, &settings.cost); break;
+            case 18: lirs(pages, capacity, cout, csv, true, &settings.cost); break;
+            case 19: car(pages, capacity, cout, csv, true, &settings.cost); break;
+            case 20: {
+                pair<long long, long long> counts = adaptive(pages, capacity, cout, csv, true, &settings.cost, settings);
+                ostringstream sink;
+                pair<long long, long long> best = optimal(pages, capacity, sink, sink, false, nullptr);
+                double rate = 100.0 * counts.first / max<size_t>(1, pages.size());
+                double optimalRate = 100.0 * best.first / max<size_t>(1, pages.size());
+                cout << "\n Compare with Optimal:\n";
+                cout << "Optimal Hit Rate   : " << fixed << setprecision(2) << optimalRate << "%\n";
+                cout << "Adaptive Hit Rate  : " << rate << "% (" << optimalRate - rate << " points below Optimal, "
+                     << 100.0 * counts.first / max(1LL, best.first) << "% of its hits)\n";
+                break;
+            }
+            case 11: {
+                int maxFrames;
+                cout << "Enter maximum number of frames for the curve: ";
+                cin >> maxFrames;
+                if (maxFrames < 1 || pages.empty()) {
+                    cout << "Invalid frame count!\n";
+                    break;
+                }
+                missRatioCurve(pages, maxFrames, "mrc.csv");
+                break;
+            }
+            case 15: {
+                long long maxFrames;
+                double rate;
+                int budget;
+                cout << "Enter maximum number of frames for the curve: ";
+                cin >> maxFrames;
+                cout << "Enter sampling rate (e.g. 0.01) and sample budget in pages (0 = no cap): ";
+                cin >> rate >> budget;
+                if (maxFrames < 1 || rate <= 0 || rate > 1 || budget < 0) {
+                    cout << "Invalid curve settings!\n";
+                    break;
+                }
+                ShardsMrc shards(maxFrames, rate, budget);
+                forEachPage(pages, [&shards](size_t, int page) { shards.add(page); });
+                shards.write("mrc_approx.csv", cout);
+                break;
+            }
+            case 12: {
+                int from, to, step;
+                cout << "Enter smallest frame count, largest frame count and step: ";
+                cin >> from >> to >> step;
+                if (from < 1 || to < from || step < 1) {
+                    cout << "Invalid frame range!\n";
+                    break;
+                }
+                vector<int> capacities;
+                for (int c = from; c <= to; c += step) capacities.push_back(c);
+                vector<SweepResult> results = runSweep(pages, capacities, threads, settings);
+
+                for (const SweepResult& r : results) {
+                    report << "Frames: " << r.capacity << "\n" << r.report;
+                    csv << r.capacity << "," << r.csv;
+                }
+
+                size_t perCapacity = results.size() / capacities.size();
+                cout << "\n" << setw(8) << left << "Frames";
+                for (size_t p = 0; p < perCapacity; ++p) cout << " | " << setw(max<size_t>(results[p].name.size(), 6)) << right << results[p].name << left;
+                cout << "\n";
+                for (size_t c = 0; c < capacities.size(); ++c) {
+                    cout << setw(8) << left << capacities[c];
+                    for (size_t p = 0; p < perCapacity; ++p) {
+                        const SweepResult& r = results[c * perCapacity + p];
+                        cout << " | " << setw(max<size_t>(r.name.size(), 6)) << right << fixed << setprecision(2)
+                             << 100.0 * r.counts.first / pages.size() << left;
+                    }
+                    cout << "\n";
+                }
+                cout << "\n Report generated: report.txt and report.csv\n";
+                break;
+            }
+            case 0: cout << "Thanks for using the simulator!\n"; break;
+            default: cout << "Invalid choice!\n"; break;
+        }
+
+        if (traced && frameLog().isOpen()) {
+            if (!frameLog().close()) cerr << "Could not write " << eventPath << "\n";
+            else if (pages.size() <= SHOW_FRAMES_UP_TO) decodeEventLog(eventPath, cout);
+            else cout << "\nFrame events written to " << eventPath << "; view them with --decode " << eventPath << "\n";
+        }
+
+        report.close();
+        csv.close();
+    } while (choice != 0);
+
+    return 0;
+}
+#endif
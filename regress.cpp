@@ -0,0 +1,983 @@
+// Regression checks for the replacement engines.
+//
+// Build: g++ -std=c++17 -O2 -pthread regress.cpp -o regress
+// Usage: regress
+//
+// Replays fixed traces (textbook reference strings and seeded synthetic
+// workloads) through every policy and compares hit and fault counts with
+// reference models: the original list-and-scan implementations for FIFO,
+// LRU, Optimal, Second Chance, Aging and the custom rules, a model of the
+// documented LFU/MFU tie-breaking and decay, and the published algorithms
+// for GCLOCK, CLOCK-Pro, ARC, 2Q, LIRS and CAR. It also checks that the
+// miss-ratio curve and the parallel sweep agree with per-capacity runs,
+// that a sampled frame event log decodes to the same frame views as
+// printing them directly, and that the multiprogramming simulator's global
+// and local replacement match standalone runs and its load control kicks in
+// under thrashing.
+// Prints every mismatch and exits with 1 if there was any.
+#define OS_PROJECT_NO_MAIN
+#include "os_project.cpp"
+
+#include <list>
+#include <unordered_set>
+
+int checks = 0, failures = 0;
+
+void check(bool ok, const string& what) {
+    checks++;
+    if (!ok) {
+        failures++;
+        cerr << "FAIL: " << what << "\n";
+    }
+}
+
+string counts(pair<long long, long long> c) { return to_string(c.first) + "/" + to_string(c.second); }
+
+// Runs a reference model, one access(page) per reference, for hits/faults.
+template <class Model>
+pair<long long, long long> replay(Model model, const vector<int>& pages) {
+    long long hits = 0;
+    for (int page : pages) hits += model.access(page);
+    return {hits, (long long)pages.size() - hits};
+}
+
+// Baseline models
+// The original implementations, minus the frame display.
+struct BaselineFifo {
+    int capacity;
+    unordered_set<int> s;
+    queue<int> q;
+
+    BaselineFifo(int capacity) : capacity(capacity) {}
+
+    bool access(int page) {
+        if (s.count(page)) return true;
+        if ((int)s.size() == capacity) {
+            s.erase(q.front());
+            q.pop();
+        }
+        s.insert(page);
+        q.push(page);
+        return false;
+    }
+};
+
+struct BaselineLru {
+    int capacity;
+    list<int> order;
+    unordered_map<int, list<int>::iterator> where;
+
+    BaselineLru(int capacity) : capacity(capacity) {}
+
+    bool access(int page) {
+        bool hit = where.count(page) > 0;
+        if (hit) {
+            order.erase(where[page]);
+        } else if ((int)order.size() == capacity) {
+            where.erase(order.back());
+            order.pop_back();
+        }
+        order.push_front(page);
+        where[page] = order.begin();
+        return hit;
+    }
+};
+
+// Scans ahead for every frame on each fault; ties go to the first frame.
+struct BaselineOptimal {
+    int capacity;
+    const vector<int>& pages;
+    size_t i = 0;
+    vector<int> frames;
+
+    BaselineOptimal(int capacity, const vector<int>& pages) : capacity(capacity), pages(pages) {}
+
+    bool access(int page) {
+        size_t now = i++;
+        if (find(frames.begin(), frames.end(), page) != frames.end()) return true;
+        if ((int)frames.size() < capacity) {
+            frames.push_back(page);
+            return false;
+        }
+        size_t farthest = now + 1;
+        int index = -1;
+        for (size_t j = 0; j < frames.size(); ++j) {
+            size_t k = now + 1;
+            while (k < pages.size() && pages[k] != frames[j]) k++;
+            if (k > farthest) {
+                farthest = k;
+                index = j;
+            }
+        }
+        frames[max(index, 0)] = page;
+        return false;
+    }
+};
+
+struct BaselineSecondChance {
+    int capacity;
+    deque<pair<int, bool>> mem;
+
+    BaselineSecondChance(int capacity) : capacity(capacity) {}
+
+    bool access(int page) {
+        for (auto& entry : mem) {
+            if (entry.first == page) {
+                entry.second = true;
+                return true;
+            }
+        }
+        if ((int)mem.size() == capacity) {
+            for (;;) {
+                pair<int, bool> front = mem.front();
+                mem.pop_front();
+                if (!front.second) break;
+                mem.push_back({front.first, false});
+            }
+        }
+        mem.push_back({page, true});
+        return false;
+    }
+};
+
+// Every reference shifts all counters, then sets the top bit of its page;
+// the victim is the first loaded page with the smallest counter.
+struct BaselineAging {
+    int capacity, bits;
+    vector<int> mem;
+    unordered_map<int, uint64_t> counter;
+
+    BaselineAging(int capacity, int bits) : capacity(capacity), bits(bits) {}
+
+    bool access(int page) {
+        uint64_t top = uint64_t(1) << (bits - 1);
+        for (int p : mem) counter[p] >>= 1;
+        if (find(mem.begin(), mem.end(), page) != mem.end()) {
+            counter[page] |= top;
+            return true;
+        }
+        if ((int)mem.size() == capacity) {
+            int victim = mem[0];
+            for (int p : mem) {
+                if (counter[p] < counter[victim]) victim = p;
+            }
+            mem.erase(find(mem.begin(), mem.end(), victim));
+            counter.erase(victim);
+        }
+        mem.push_back(page);
+        counter[page] = top;
+        return false;
+    }
+};
+
+// Rule 1 evicts the first loaded page with the fewest references among the
+// last windowSize (including this one); rule 2 the first odd page, else the
+// first loaded.
+struct BaselineCustom {
+    int capacity, rule, windowSize;
+    vector<int> mem, recent;
+
+    BaselineCustom(int capacity, int rule, int windowSize) : capacity(capacity), rule(rule), windowSize(windowSize) {}
+
+    bool access(int page) {
+        recent.push_back(page);
+        if ((int)recent.size() > windowSize) recent.erase(recent.begin());
+        if (find(mem.begin(), mem.end(), page) != mem.end()) return true;
+        if ((int)mem.size() == capacity) {
+            int victim = mem[0];
+            if (rule == 1) {
+                int fewest = INT_MAX;
+                for (int p : mem) {
+                    int c = count(recent.begin(), recent.end(), p);
+                    if (c < fewest) {
+                        fewest = c;
+                        victim = p;
+                    }
+                }
+            } else {
+                for (int p : mem) {
+                    if (p % 2 != 0) {
+                        victim = p;
+                        break;
+                    }
+                }
+            }
+            mem.erase(find(mem.begin(), mem.end(), victim));
+        }
+        mem.push_back(page);
+        return false;
+    }
+};
+
+// LFU / MFU
+// Evicts the lowest (LFU) or highest (MFU) frequency; among equals, the page
+// that reached that frequency first. A decay halves every frequency (never
+// below 1) before every decayInterval-th reference, keeping pages that end
+// up equal in the order of their old frequency, then of when they got it.
+struct FrequencyModel {
+    int capacity;
+    bool evictMost;
+    int decayInterval;
+    long long refs = 0, clock = 0;
+    map<int, pair<int, long long>> state; // page -> (frequency, when it got there)
+
+    FrequencyModel(int capacity, bool evictMost, int decayInterval) : capacity(capacity), evictMost(evictMost), decayInterval(decayInterval) {}
+
+    bool access(int page) {
+        if (decayInterval > 0 && refs > 0 && refs % decayInterval == 0) decay();
+        refs++;
+        auto it = state.find(page);
+        if (it != state.end()) {
+            it->second = {it->second.first + 1, ++clock};
+            return true;
+        }
+        if ((int)state.size() == capacity) {
+            auto victim = state.begin();
+            for (auto p = state.begin(); p != state.end(); ++p) {
+                int f = p->second.first, v = victim->second.first;
+                bool better = evictMost ? f > v : f < v;
+                if (better || (f == v && p->second.second < victim->second.second)) victim = p;
+            }
+            state.erase(victim);
+        }
+        state[page] = {1, ++clock};
+        return false;
+    }
+
+    void decay() {
+        vector<tuple<int, int, long long, int>> order;
+        for (auto& p : state) order.emplace_back(max(1, p.second.first / 2), p.second.first, p.second.second, p.first);
+        sort(order.begin(), order.end());
+        for (auto& o : order) state[get<3>(o)] = {get<0>(o), ++clock};
+    }
+};
+
+// ARC (Megiddo & Modha, FAST 2003, Fig. 4). Lists are MRU first.
+struct TextbookArc {
+    int c, p = 0;
+    list<int> t1, t2, b1, b2;
+
+    TextbookArc(int capacity) : c(capacity) {}
+
+    static bool take(list<int>& l, int page) {
+        auto it = find(l.begin(), l.end(), page);
+        if (it == l.end()) return false;
+        l.erase(it);
+        return true;
+    }
+
+    void replace(bool inB2) {
+        int s1 = t1.size();
+        if (s1 >= 1 && ((inB2 && s1 == p) || s1 > p)) {
+            b1.push_front(t1.back());
+            t1.pop_back();
+        } else {
+            b2.push_front(t2.back());
+            t2.pop_back();
+        }
+    }
+
+    bool access(int x) {
+        if (take(t1, x) || take(t2, x)) {
+            t2.push_front(x);
+            return true;
+        }
+        int s1 = t1.size(), s2 = t2.size(), g1 = b1.size(), g2 = b2.size();
+        if (find(b1.begin(), b1.end(), x) != b1.end()) {
+            p = min(c, p + max(g2 / g1, 1));
+            replace(false);
+            take(b1, x);
+            t2.push_front(x);
+        } else if (find(b2.begin(), b2.end(), x) != b2.end()) {
+            p = max(0, p - max(g1 / g2, 1));
+            replace(true);
+            take(b2, x);
+            t2.push_front(x);
+        } else {
+            if (s1 + g1 == c) {
+                if (s1 < c) {
+                    b1.pop_back();
+                    replace(false);
+                } else {
+                    t1.pop_back();
+                }
+            } else if (s1 + s2 + g1 + g2 >= c) {
+                if (s1 + s2 + g1 + g2 == 2 * c) b2.pop_back();
+                replace(false);
+            }
+            t1.push_front(x);
+        }
+        return false;
+    }
+};
+
+// 2Q (Johnson & Shasha, VLDB 1994), full version with Kin = c/4 and
+// Kout = c/2. A page found in A1out leaves it when it enters Am. Am being
+// empty (only possible with a single frame) falls back to A1in.
+struct TextbookTwoQ {
+    int c, kin, kout;
+    list<int> a1in, a1out, am; // A1in and A1out newest first, Am MRU first
+
+    TextbookTwoQ(int capacity) : c(capacity), kin(max(1, capacity / 4)), kout(max(1, capacity / 2)) {}
+
+    bool access(int x) {
+        auto m = find(am.begin(), am.end(), x);
+        if (m != am.end()) {
+            am.erase(m);
+            am.push_front(x);
+            return true;
+        }
+        if (find(a1in.begin(), a1in.end(), x) != a1in.end()) return true;
+        auto out = find(a1out.begin(), a1out.end(), x);
+        bool seen = out != a1out.end();
+        if (seen) a1out.erase(out);
+        if ((int)(a1in.size() + am.size()) == c) {
+            if ((int)a1in.size() > kin || am.empty()) {
+                a1out.push_front(a1in.back());
+                a1in.pop_back();
+                if ((int)a1out.size() > kout) a1out.pop_back();
+            } else {
+                am.pop_back();
+            }
+        }
+        if (seen) am.push_front(x);
+        else a1in.push_front(x);
+        return false;
+    }
+};
+
+// LIRS (Jiang & Zhang, SIGMETRICS 2002) with Lhirs = max(1, c/100). The
+// non-resident HIR pages kept in S are capped at c, oldest dropped first.
+struct TextbookLirs {
+    int c, lirLimit, lirCount = 0;
+    list<int> s, q, ghosts; // S top first, Q oldest first, ghosts newest first
+    unordered_set<int> resident, lir;
+
+    TextbookLirs(int capacity) : c(capacity), lirLimit(capacity - max(1, capacity / 100)) {}
+
+    static bool contains(const list<int>& l, int page) { return find(l.begin(), l.end(), page) != l.end(); }
+
+    void toTop(int x) {
+        s.remove(x);
+        s.push_front(x);
+    }
+
+    void prune() {
+        while (!s.empty() && !lir.count(s.back())) {
+            int x = s.back();
+            s.pop_back();
+            if (!resident.count(x)) ghosts.remove(x);
+        }
+    }
+
+    // x, on top of S, becomes LIR; the bottom LIR page turns HIR.
+    void promote(int x) {
+        lir.insert(x);
+        if (++lirCount <= lirLimit) return;
+        prune();
+        int bottom = s.back();
+        s.pop_back();
+        lir.erase(bottom);
+        lirCount--;
+        q.push_back(bottom);
+        prune();
+    }
+
+    bool access(int x) {
+        if (resident.count(x)) {
+            if (lir.count(x)) {
+                bool bottom = s.back() == x;
+                toTop(x);
+                if (bottom) prune();
+            } else if (contains(s, x)) {
+                toTop(x);
+                q.remove(x);
+                promote(x);
+            } else {
+                s.push_front(x);
+                q.remove(x);
+                q.push_back(x);
+            }
+            return true;
+        }
+        if ((int)resident.size() == c) {
+            int victim = q.front();
+            q.pop_front();
+            resident.erase(victim);
+            if (contains(s, victim)) {
+                ghosts.push_front(victim);
+                if ((int)ghosts.size() > c) {
+                    s.remove(ghosts.back());
+                    ghosts.pop_back();
+                }
+            }
+        }
+        resident.insert(x);
+        if (contains(s, x)) {
+            ghosts.remove(x);
+            toTop(x);
+            promote(x);
+        } else {
+            s.push_front(x);
+            if (lirCount < lirLimit) {
+                lir.insert(x);
+                lirCount++;
+            } else {
+                q.push_back(x);
+            }
+        }
+        return false;
+    }
+};
+
+// CAR (Bansal & Modha, FAST 2004, Fig. 2). T1 and T2 are clocks read from
+// the head; B1 and B2 are MRU first.
+struct TextbookCar {
+    int c, p = 0;
+    deque<int> t1, t2;
+    list<int> b1, b2;
+    unordered_map<int, bool> ref;
+
+    TextbookCar(int capacity) : c(capacity) {}
+
+    void replace() {
+        for (;;) {
+            if ((int)t1.size() >= max(1, p)) {
+                int x = t1.front();
+                t1.pop_front();
+                if (!ref[x]) {
+                    b1.push_front(x);
+                    ref.erase(x);
+                    return;
+                }
+                ref[x] = false;
+                t2.push_back(x);
+            } else {
+                int x = t2.front();
+                t2.pop_front();
+                if (!ref[x]) {
+                    b2.push_front(x);
+                    ref.erase(x);
+                    return;
+                }
+                ref[x] = false;
+                t2.push_back(x);
+            }
+        }
+    }
+
+    bool access(int x) {
+        if (ref.count(x)) {
+            ref[x] = true;
+            return true;
+        }
+        bool inB1 = find(b1.begin(), b1.end(), x) != b1.end();
+        bool inB2 = find(b2.begin(), b2.end(), x) != b2.end();
+        if ((int)(t1.size() + t2.size()) == c) {
+            replace();
+            if (!inB1 && !inB2) {
+                if ((int)(t1.size() + b1.size()) == c) b1.pop_back();
+                else if ((int)(t1.size() + t2.size() + b1.size() + b2.size()) == 2 * c) b2.pop_back();
+            }
+        }
+        if (inB1) {
+            p = min(c, p + max(1, (int)(b2.size() / b1.size())));
+            b1.remove(x);
+            t2.push_back(x);
+        } else if (inB2) {
+            p = max(0, p - max(1, (int)(b1.size() / b2.size())));
+            b2.remove(x);
+            t2.push_back(x);
+        } else {
+            t1.push_back(x);
+        }
+        ref[x] = false;
+        return false;
+    }
+};
+
+// GCLOCK (Smith, 1978): every page has a use count, raised by each hit up
+// to maxCount. The hand is the front of the ring; it decrements and passes
+// pages with a nonzero count and replaces the first with none. New pages
+// start at 1 and go behind the hand.
+struct TextbookGclock {
+    int capacity, maxCount;
+    deque<pair<int, int>> ring; // (page, count), hand at the front
+
+    TextbookGclock(int capacity, int maxCount) : capacity(capacity), maxCount(maxCount) {}
+
+    bool access(int page) {
+        for (auto& entry : ring) {
+            if (entry.first == page) {
+                entry.second = min(entry.second + 1, maxCount);
+                return true;
+            }
+        }
+        if ((int)ring.size() == capacity) {
+            while (ring.front().second > 0) {
+                ring.push_back({ring.front().first, ring.front().second - 1});
+                ring.pop_front();
+            }
+            ring.pop_front();
+        }
+        ring.push_back({page, 1});
+        return false;
+    }
+};
+
+// CLOCK-Pro (Jiang, Chen & Zhang, USENIX ATC 2005). One clock holds hot
+// pages, resident cold pages and non-resident cold pages in their test
+// period; new and moved pages go to the list head, just behind HAND_hot.
+// The cold allocation mc starts at 1 and stays within [1, c]: a reference
+// to a non-resident test page raises it, a test period ending unused
+// lowers it.
+//   HAND_cold, to free a frame: a referenced cold page in its test period
+//     turns hot, one outside it starts a test period; either moves to the
+//     head. An unreferenced cold page is evicted, staying as non-resident
+//     if in its test period. With no cold page it first runs HAND_hot.
+//   HAND_hot: clears the reference bit of hot pages until it demotes an
+//     unreferenced one to cold, ending the test periods of the cold pages
+//     it passes.
+//   HAND_test: ends test periods until a non-resident page is dropped.
+// A fault frees a frame first, then loads the page hot if it was a
+// non-resident test page still in the clock, else cold in a test period.
+// HAND_hot runs while there are more than c - mc hot pages, HAND_test
+// while there are more than c non-resident pages.
+struct TextbookClockPro {
+    enum State { HOT, COLD, NONRESIDENT };
+    struct Entry {
+        int page;
+        State state;
+        bool test, ref;
+    };
+    typedef list<Entry>::iterator Hand;
+
+    int c, mc = 1, resident = 0, hot = 0, cold = 0, nonresident = 0;
+    list<Entry> clock;
+    unordered_map<int, Hand> where;
+    Hand handHot, handCold, handTest;
+
+    TextbookClockPro(int capacity) : c(capacity) {}
+
+    Hand next(Hand h) { return ++h == clock.end() ? clock.begin() : h; }
+
+    // Takes e out of the clock; hands on it move to the next entry.
+    Entry take(Hand e) {
+        Hand after = next(e);
+        if (handHot == e) handHot = after;
+        if (handCold == e) handCold = after;
+        if (handTest == e) handTest = after;
+        Entry entry = *e;
+        where.erase(entry.page);
+        clock.erase(e);
+        return entry;
+    }
+
+    void toHead(const Entry& entry) {
+        Hand e;
+        if (clock.empty()) {
+            clock.push_back(entry);
+            e = handHot = handCold = handTest = clock.begin();
+        } else {
+            e = clock.insert(handHot, entry);
+        }
+        where[entry.page] = e;
+    }
+
+    void endTest(Hand e) {
+        e->test = false;
+        mc = max(1, mc - 1);
+        if (e->state == NONRESIDENT) {
+            take(e);
+            nonresident--;
+        }
+    }
+
+    void runHandHot() {
+        for (;;) {
+            Hand e = handHot;
+            handHot = next(e);
+            if (e->state == HOT) {
+                if (!e->ref) {
+                    e->state = COLD;
+                    hot--;
+                    cold++;
+                    return;
+                }
+                e->ref = false;
+            } else if (e->test) {
+                endTest(e);
+            }
+        }
+    }
+
+    void runHandTest() {
+        for (;;) {
+            Hand e = handTest;
+            handTest = next(e);
+            if (e->state != HOT && e->test) {
+                bool dropped = e->state == NONRESIDENT;
+                endTest(e);
+                if (dropped) return;
+            }
+        }
+    }
+
+    void runHandCold() {
+        for (;;) {
+            if (cold == 0) runHandHot();
+            Hand e = handCold;
+            if (e->state != COLD) {
+                handCold = next(e);
+            } else if (e->ref) {
+                Entry entry = take(e);
+                entry.ref = false;
+                if (entry.test) {
+                    entry.state = HOT;
+                    entry.test = false;
+                    cold--;
+                    hot++;
+                    toHead(entry);
+                    while (hot > c - mc) runHandHot();
+                } else {
+                    entry.test = true;
+                    toHead(entry);
+                }
+            } else {
+                handCold = next(e);
+                cold--;
+                resident--;
+                if (e->test) {
+                    e->state = NONRESIDENT;
+                    nonresident++;
+                } else {
+                    take(e);
+                }
+                return;
+            }
+        }
+    }
+
+    bool access(int x) {
+        auto it = where.find(x);
+        if (it != where.end() && it->second->state != NONRESIDENT) {
+            it->second->ref = true;
+            return true;
+        }
+        if (resident == c) runHandCold();
+        resident++;
+        it = where.find(x);
+        if (it != where.end()) {
+            take(it->second);
+            nonresident--;
+            mc = min(mc + 1, c);
+            toHead({x, HOT, false, false});
+            hot++;
+        } else {
+            toHead({x, COLD, true, false});
+            cold++;
+        }
+        while (hot > c - mc) runHandHot();
+        while (nonresident > c) runHandTest();
+        return false;
+    }
+};
+
+// Traces
+vector<int> parseTrace(const string& text) {
+    istringstream in(text);
+    vector<int> pages;
+    for (int page; in >> page;) pages.push_back(page);
+    return pages;
+}
+
+vector<pair<string, vector<int>>> traces() {
+    vector<pair<string, vector<int>>> list = {
+        {"textbook", parseTrace("7 0 1 2 0 3 0 4 2 3 0 3 2 1 2 0 1 7 0 1")},
+        {"belady", parseTrace("1 2 3 4 1 2 5 1 2 3 4 5")},
+    };
+    const string kinds[] = {"uniform", "zipf", "loop", "phased", "scan+hot"};
+    for (const string& kind : kinds) {
+        WorkloadSpec spec;
+        spec.kind = kind;
+        spec.pageSpace = 96;
+        spec.seed = 2024;
+        spec.loopLength = 40;
+        spec.workingSet = 12;
+        spec.phaseLength = 500;
+        spec.hotPages = 16;
+        list.push_back({kind, generateWorkload(spec, 3000)});
+    }
+    WorkloadSpec wide;
+    wide.kind = "zipf";
+    wide.pageSpace = 1500;
+    wide.seed = 11;
+    list.push_back({"zipf-wide", generateWorkload(wide, 4000)});
+    vector<int> mixed = generateWorkload(WorkloadSpec(), 500);
+    for (int& page : mixed) page = page % 3 == 0 ? -page : page * 7; // negative and sparse ids
+    list.push_back({"mixed-sign", mixed});
+    return list;
+}
+
+const vector<int> CAPACITIES = {1, 2, 3, 4, 7, 16, 33, 250};
+
+// Per-policy checks
+void checkTextbookCounts() {
+    vector<int> textbook = parseTrace("7 0 1 2 0 3 0 4 2 3 0 3 2 1 2 0 1 7 0 1");
+    vector<int> belady = parseTrace("1 2 3 4 1 2 5 1 2 3 4 5");
+    ostringstream sink;
+    check(fifo(textbook, 3, sink, sink, false, nullptr).second == 15, "FIFO textbook string, 3 frames: 15 faults");
+    check(lru(textbook, 3, sink, sink, false, nullptr).second == 12, "LRU textbook string, 3 frames: 12 faults");
+    check(optimal(textbook, 3, sink, sink, false, nullptr).second == 9, "Optimal textbook string, 3 frames: 9 faults");
+    check(fifo(belady, 3, sink, sink, false, nullptr).second == 9, "FIFO Belady string, 3 frames: 9 faults");
+    check(fifo(belady, 4, sink, sink, false, nullptr).second == 10, "FIFO Belady string, 4 frames: 10 faults");
+}
+
+void checkPolicies(const string& traceName, const vector<int>& pages) {
+    ostringstream sink;
+    auto same = [&](const string& name, int capacity, pair<long long, long long> got, pair<long long, long long> want) {
+        check(got == want, name + " on " + traceName + " with " + to_string(capacity) + " frames: " + counts(got) + ", expected " + counts(want));
+    };
+    for (int c : CAPACITIES) {
+        same("FIFO", c, fifo(pages, c, sink, sink, false, nullptr), replay(BaselineFifo(c), pages));
+        same("LRU", c, lru(pages, c, sink, sink, false, nullptr), replay(BaselineLru(c), pages));
+        same("Optimal", c, optimal(pages, c, sink, sink, false, nullptr), replay(BaselineOptimal(c, pages), pages));
+        same("Second Chance", c, secondChance(pages, c, sink, sink, false, nullptr), replay(BaselineSecondChance(c), pages));
+        for (int bits : {8, 16, 32}) {
+            same("Aging " + to_string(bits) + "-bit", c, aging(pages, c, sink, sink, false, nullptr, 1, bits),
+                 replay(BaselineAging(c, bits), pages));
+        }
+        for (int window : {1, 4, 9}) {
+            same("Custom (Fewest in Window " + to_string(window) + ")", c, custom(pages, c, sink, sink, false, nullptr, 1, window),
+                 replay(BaselineCustom(c, 1, window), pages));
+        }
+        same("Custom (Even Priority)", c, custom(pages, c, sink, sink, false, nullptr, 2, 4), replay(BaselineCustom(c, 2, 4), pages));
+        same("LFU", c, lfu(pages, c, sink, sink, false, nullptr), replay(FrequencyModel(c, false, 0), pages));
+        same("LFU (Decay 50)", c, lfu(pages, c, sink, sink, false, nullptr, 50), replay(FrequencyModel(c, false, 50), pages));
+        same("MFU", c, mfu(pages, c, sink, sink, false, nullptr), replay(FrequencyModel(c, true, 0), pages));
+        same("ARC", c, arc(pages, c, sink, sink, false, nullptr), replay(TextbookArc(c), pages));
+        same("2Q", c, twoQ(pages, c, sink, sink, false, nullptr), replay(TextbookTwoQ(c), pages));
+        same("LIRS", c, lirs(pages, c, sink, sink, false, nullptr), replay(TextbookLirs(c), pages));
+        same("CAR", c, car(pages, c, sink, sink, false, nullptr), replay(TextbookCar(c), pages));
+        same("GCLOCK", c, gclock(pages, c, sink, sink, false, nullptr), replay(TextbookGclock(c, GCLOCK_MAX_COUNT), pages));
+        same("CLOCK-Pro", c, clockPro(pages, c, sink, sink, false, nullptr), replay(TextbookClockPro(c), pages));
+    }
+}
+
+// Runs `run` with cout captured.
+string captureCout(const function<void()>& run) {
+    ostringstream captured;
+    streambuf* old = cout.rdbuf(captured.rdbuf());
+    run();
+    cout.rdbuf(old);
+    return captured.str();
+}
+
+// Miss-ratio curve against lru() and optimal() run per capacity.
+void checkMissRatioCurve(const string& traceName, PageView pages) {
+    const int maxFrames = 40;
+    const string path = "regress_mrc.csv";
+    captureCout([&] { missRatioCurve(pages, maxFrames, path); });
+    ifstream in(path);
+    string line;
+    getline(in, line);
+    ostringstream sink;
+    for (int c = 1; c <= maxFrames; ++c) {
+        long long lruHits = -1, optHits = -1;
+        if (getline(in, line)) {
+            replace(line.begin(), line.end(), ',', ' ');
+            istringstream row(line);
+            double rate;
+            int frames;
+            row >> frames >> lruHits >> rate >> optHits;
+        }
+        string where = traceName + (pages.packed ? " (packed)" : "") + " with " + to_string(c) + " frames";
+        check(lruHits == lru(pages, c, sink, sink, false, nullptr).first, "MRC LRU hits on " + where);
+        check(optHits == optimal(pages, c, sink, sink, false, nullptr).first, "MRC OPT hits on " + where);
+    }
+    in.close();
+    remove(path.c_str());
+}
+
+// Parallel sweep against each policy's standalone run.
+void checkSweep(const string& traceName, PageView pages, const SimSettings& settings) {
+    vector<int> capacities = {1, 5, 16, 64};
+    size_t blocksRead = 0;
+    vector<SweepResult> results = runSweep(pages, capacities, 4, settings, &blocksRead);
+    check(blocksRead == pages.blocks(), "sweep on " + traceName + " reads each of its " + to_string(pages.blocks()) + " blocks once, read " + to_string(blocksRead));
+    vector<PolicyRun> table = allPolicies(settings);
+    check(results.size() == table.size() * capacities.size(), "sweep on " + traceName + " covers every policy and capacity");
+    map<pair<string, int>, pair<long long, long long>> standalone;
+    ostringstream sink;
+    for (const PolicyRun& p : table) {
+        for (int c : capacities) standalone[{p.name, c}] = p.run(pages, c, sink, sink);
+    }
+    for (const SweepResult& r : results) {
+        auto it = standalone.find({r.name, r.capacity});
+        check(it != standalone.end() && it->second == r.counts,
+              "sweep " + r.name + " on " + traceName + (pages.packed ? " (packed)" : "") + " with " + to_string(r.capacity) +
+                  " frames: " + counts(r.counts) + (it != standalone.end() ? ", standalone " + counts(it->second) : ", no standalone run"));
+    }
+}
+
+// Frame event log
+// A traced run printed directly is split into its printFrames() blocks; the
+// decoded log of the same run under each sampling mode must be exactly the
+// sampled blocks.
+void checkEventLog(const string& traceName, const string& policy, const function<void()>& tracedRun) {
+    string direct = captureCout(tracedRun);
+    const string separator = "\n" + string(40, '-') + "\n";
+    vector<string> blocks;
+    for (size_t from = 0, end; (end = direct.find(separator, from)) != string::npos; from = end + separator.size()) {
+        blocks.push_back(direct.substr(from, end + separator.size() - from));
+    }
+
+    const string path = "regress.events";
+    EventSampling modes[4];
+    modes[1].every = 3;
+    modes[2].every = 7;
+    modes[3].faultsOnly = true;
+    for (const EventSampling& mode : modes) {
+        string expected;
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            bool hit = blocks[i].find("Page HIT") != string::npos;
+            if (mode.faultsOnly ? !hit : i % mode.every == 0) expected += blocks[i];
+        }
+        ostringstream decoded;
+        bool ok = frameLog().open(path, mode);
+        if (ok) tracedRun();
+        ok = frameLog().close() && ok && decodeEventLog(path, decoded);
+        string label = mode.faultsOnly ? "faults only" : "every " + to_string(mode.every);
+        check(ok && decoded.str() == expected, "event log of " + policy + " on " + traceName + " (" + label + ") decodes to the printed frames");
+    }
+    remove(path.c_str());
+}
+
+void checkEventLogs(const string& traceName, const vector<int>& pages) {
+    ostringstream sink;
+    int c = 5;
+    checkEventLog(traceName, "FIFO", [&] { fifo(pages, c, sink, sink, true, nullptr); });
+    checkEventLog(traceName, "Optimal", [&] { optimal(pages, c, sink, sink, true, nullptr); });
+    checkEventLog(traceName, "LIRS", [&] { lirs(pages, c, sink, sink, true, nullptr); });
+    checkEventLog(traceName, "Aging", [&] { aging(pages, c, sink, sink, true, nullptr); });
+    // A short window makes Adaptive switch policies several times mid-trace.
+    SimSettings settings;
+    settings.adaptWindow = 40;
+    checkEventLog(traceName, "Adaptive", [&] {
+        AdaptivePolicy policy(c, settings);
+        simulate("Adaptive", policy, pages, sink, sink, true, nullptr);
+    });
+}
+
+// Multiprogramming
+// A single process under global replacement and processes with an equal
+// local split must fault exactly as standalone runs of the same policy;
+// working-set load control must suspend processes whose working sets do not
+// fit. Faults take one reference's CPU time, so no process falls far
+// behind.
+void checkMultiprogram() {
+    MultiprogramSpec spec;
+    spec.quantum = 10;
+    CostModel cost;
+    cost.fault.a = spec.cpuNs;
+    WorkloadSpec workload;
+    workload.kind = "zipf";
+    workload.pageSpace = 200;
+    vector<int> single = generateWorkload(workload, 3000);
+    for (const PolicyFactory& f : onlineFactories(SimSettings())) {
+        MultiprogramSim sim({PageView(single)}, {0}, 1, 32, f, spec, cost);
+        MultiprogramResult r = sim.run();
+        unique_ptr<StreamPolicy> alone(f.make(32));
+        long long faults = 0;
+        for (int page : single) faults += alone->push(page) == 0;
+        check(r.faults() == faults, f.name + " as one process under global replacement: " + to_string(r.faults()) + " faults, standalone " + to_string(faults));
+    }
+
+    // Every trace ends in a long run of one page, so all processes are done
+    // with the rest of their trace, and only hit, when the first finishes
+    // and the others' allocations grow.
+    const int processes = 3, frames = 48;
+    vector<vector<int>> traces;
+    for (int i = 0; i < processes; ++i) {
+        workload.seed = 100 + i;
+        traces.push_back(generateWorkload(workload, 2000));
+        traces.back().insert(traces.back().end(), 100000, traces.back().back());
+    }
+    vector<PageView> views(traces.begin(), traces.end());
+    spec.global = false;
+    for (const PolicyFactory& f : onlineFactories(SimSettings())) {
+        MultiprogramSim sim(views, {0, 0, 0}, processes, frames, f, spec, cost);
+        MultiprogramResult r = sim.run();
+        for (int i = 0; i < processes; ++i) {
+            unique_ptr<StreamPolicy> alone(f.make(frames / processes));
+            long long faults = 0;
+            for (int page : traces[i]) faults += alone->push(page) == 0;
+            check(r.processes[i].faults == faults, f.name + " process " + to_string(i) + " with local replacement over " + to_string(frames / processes) +
+                                                      " frames: " + to_string(r.processes[i].faults) + " faults, standalone " + to_string(faults));
+        }
+    }
+
+    // Three loops of 40 pages need 120 frames; 64 fit only one at a time.
+    workload.kind = "loop";
+    workload.pageSpace = 40;
+    workload.loopLength = 40;
+    vector<int> loop = generateWorkload(workload, 20000);
+    spec.allocator = "ws";
+    spec.window = 200;
+    vector<PolicyFactory> factories = onlineFactories(SimSettings());
+    const PolicyFactory& lru = *find_if(factories.begin(), factories.end(), [](const PolicyFactory& f) { return f.name == "LRU"; });
+    for (bool global : {true, false}) {
+        spec.global = global;
+        MultiprogramSim sim({loop, loop, loop}, {0, 40, 80}, 3, 64, lru, spec, cost);
+        MultiprogramResult r = sim.run();
+        string scope = global ? "global" : "local";
+        check(r.suspensions > 0, "working-set load control suspends a process of three thrashing loops (" + scope + ")");
+        check(r.references() == 3 * (long long)loop.size(), "suspended processes still run to the end (" + scope + ")");
+    }
+    spec.allocator = "equal";
+    MultiprogramSim sim({loop, loop, loop}, {0, 40, 80}, 3, 64, lru, spec, cost);
+    check(sim.run().suspensions == 0, "equal allocation has no load control");
+}
+
+int main() {
+    checkTextbookCounts();
+    for (const auto& t : traces()) {
+        checkPolicies(t.first, t.second);
+        PackedTrace packed;
+        packed.append(t.second.data(), t.second.size());
+        packed.finish();
+        for (PageView view : {PageView(t.second), PageView(packed, nullptr)}) {
+            checkMissRatioCurve(t.first, view);
+            checkSweep(t.first, view, SimSettings());
+        }
+    }
+
+    SimSettings variants;
+    variants.lfuDecay = 50;
+    variants.agingTick = 3;
+    variants.agingBits = 16;
+    variants.adaptWindow = 200;
+    vector<int> phased = traces()[5].second;
+    checkSweep("phased (variant settings)", phased, variants);
+
+    // Several blocks, the last one partial.
+    WorkloadSpec spec;
+    spec.kind = "phased";
+    spec.pageSpace = 300;
+    spec.seed = 5;
+    spec.phaseLength = 3000;
+    vector<int> longTrace = generateWorkload(spec, 5 * TRACE_BLOCK + 123);
+    PackedTrace packed;
+    packed.append(longTrace.data(), longTrace.size());
+    packed.finish();
+    checkSweep("long phased", longTrace, variants);
+    checkSweep("long phased", PageView(packed, nullptr), variants);
+
+    vector<int> shortTrace(phased.begin(), phased.begin() + 300);
+    checkEventLogs("phased", shortTrace);
+
+    checkMultiprogram();
+
+    cout << checks - failures << " of " << checks << " checks passed\n";
+    return failures > 0 ? 1 : 0;
+}